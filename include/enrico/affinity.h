@@ -0,0 +1,41 @@
+//! \file affinity.h
+//! Queries and control of CPU affinity used for placing driver ranks
+#ifndef ENRICO_AFFINITY_H
+#define ENRICO_AFFINITY_H
+
+#include <string>
+#include <vector>
+
+namespace enrico {
+
+//! Strategies for choosing the ranks on each node that join a driver communicator.
+//! 'rank' keeps the lowest node-local ranks, while 'numa' and 'socket' take ranks
+//! round-robin from the NUMA domains or sockets their CPUs belong to.
+enum class Placement { rank, numa, socket };
+
+//! Get the CPUs that the calling thread is allowed to run on
+//! \return Sorted CPU indices, or an empty vector if the affinity cannot be queried
+std::vector<int> affinity_cpus();
+
+//! Get the NUMA domain or socket containing the first CPU of the calling thread
+//! \param placement Kind of domain; Placement::rank always yields 0
+//! \return Index of the domain, or 0 if the topology is unavailable
+int affinity_domain(Placement placement);
+
+//! Format CPU indices as a compact list of ranges, e.g. "0-3,8"
+//! \param cpus Sorted CPU indices
+//! \return Formatted list, or "-" if cpus is empty
+std::string cpu_list_string(const std::vector<int>& cpus);
+
+//! Set the number of OpenMP threads used by subsequent parallel regions
+//! \param n_threads Number of threads. Does nothing if ENRICO was built without OpenMP.
+void set_num_threads(int n_threads);
+
+//! Pin each OpenMP thread of the calling rank to one CPU of the rank's affinity mask.
+//! Threads are assigned CPUs in order, wrapping around if there are more threads than
+//! CPUs. Does nothing if ENRICO was built without OpenMP.
+void bind_threads();
+
+} // namespace enrico
+
+#endif // ENRICO_AFFINITY_H
@@ -0,0 +1,41 @@
+//! \file allocation_counter.h
+//! Debug counter of heap allocations
+#ifndef ENRICO_ALLOCATION_COUNTER_H
+#define ENRICO_ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+namespace enrico {
+
+//! Whether heap allocations are counted. This requires building with
+//! -DENRICO_COUNT_ALLOCATIONS=ON, which replaces the global operator new.
+#ifdef ENRICO_COUNT_ALLOCATIONS
+constexpr bool COUNT_ALLOCATIONS = true;
+#else
+constexpr bool COUNT_ALLOCATIONS = false;
+#endif
+
+//! Get the number of heap allocations made by the calling process so far
+//! \return Number of allocations, or zero if allocations are not counted
+std::size_t allocation_count();
+
+//! Adds the number of heap allocations made during its lifetime to a running total
+class AllocationScope {
+public:
+  //! Start counting allocations
+  //! \param total Running total that the allocations are added to
+  explicit AllocationScope(std::size_t& total)
+    : total_(total)
+    , start_(allocation_count())
+  {}
+
+  ~AllocationScope() { total_ += allocation_count() - start_; }
+
+private:
+  std::size_t& total_; //!< Running total of allocations
+  std::size_t start_;  //!< Allocation count at the start of the scope
+};
+
+} // namespace enrico
+
+#endif // ENRICO_ALLOCATION_COUNTER_H
@@ -0,0 +1,105 @@
+//! \file bit_mask.h
+//! Bit-packed boolean mask
+#ifndef ENRICO_BIT_MASK_H
+#define ENRICO_BIT_MASK_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace enrico {
+
+//! A fixed-size sequence of booleans stored one bit per value
+//!
+//! The bits are stored in 64-bit words, which are exposed so that the mask can be
+//! communicated with the Comm wrappers. Setting bits is not thread-safe unless each
+//! thread sets bits in different words.
+class BitMask {
+public:
+  //! Number of bits in each word
+  static constexpr std::size_t BITS_PER_WORD = 64;
+
+  BitMask() = default;
+
+  //! Create a mask with all bits cleared
+  //! \param size Number of bits
+  explicit BitMask(std::size_t size)
+    : size_(size)
+    , words_(n_words(size), 0)
+  {}
+
+  //! Create a mask from integer flags
+  //! \param flags Values that are nonzero where the bit is set
+  explicit BitMask(const std::vector<int>& flags)
+    : BitMask(flags.size())
+  {
+    for (std::size_t i = 0; i < flags.size(); ++i) {
+      if (flags[i] != 0) {
+        set(i);
+      }
+    }
+  }
+
+  //! Get a bit
+  //! \param i Index of the bit
+  //! \return Whether the bit is set
+  bool operator[](std::size_t i) const
+  {
+    return (words_[i / BITS_PER_WORD] >> (i % BITS_PER_WORD)) & 1;
+  }
+
+  //! Set a bit
+  //! \param i Index of the bit
+  void set(std::size_t i)
+  {
+    words_[i / BITS_PER_WORD] |= std::uint64_t{1} << (i % BITS_PER_WORD);
+  }
+
+  //! Clear a bit
+  //! \param i Index of the bit
+  void reset(std::size_t i)
+  {
+    words_[i / BITS_PER_WORD] &= ~(std::uint64_t{1} << (i % BITS_PER_WORD));
+  }
+
+  //! Get the number of set bits
+  //! \return Number of set bits
+  std::size_t count() const
+  {
+    std::size_t n = 0;
+    for (auto word : words_) {
+      n += std::bitset<BITS_PER_WORD>(word).count();
+    }
+    return n;
+  }
+
+  //! \return Number of bits
+  std::size_t size() const { return size_; }
+
+  //! Words holding the bits, e.g., for communicating them between masks of equal size
+  std::vector<std::uint64_t>& words() { return words_; }
+  const std::vector<std::uint64_t>& words() const { return words_; }
+
+  //! Get the number of words needed for a number of bits
+  //! \param size Number of bits
+  //! \return Number of words
+  static std::size_t n_words(std::size_t size)
+  {
+    return (size + BITS_PER_WORD - 1) / BITS_PER_WORD;
+  }
+
+private:
+  std::size_t size_{0};              //!< Number of bits
+  std::vector<std::uint64_t> words_; //!< Bits, in order from the lowest bit of word 0
+};
+
+//! Get the bytes held by a bit mask
+inline std::size_t memory_bytes(const BitMask& mask)
+{
+  return mask.words().capacity() * sizeof(std::uint64_t);
+}
+
+} // namespace enrico
+
+#endif // ENRICO_BIT_MASK_H
@@ -21,6 +21,13 @@ public:
   //! \param position The coordinate for the desired cell
   explicit CellInstance(Position position);
 
+  //! Create a cell instance from a known cell index and instance, as given by
+  //! openmc_find_cell
+  //!
+  //! \param index Index in global cells array
+  //! \param instance Index of cell instance
+  CellInstance(int32_t index, int32_t instance);
+
   //! Get the corresponding cell
   openmc::Cell* cell() const;
 
@@ -53,6 +60,10 @@ public:
   int32_t instance_;       //!< Index of cell instance
   int32_t material_index_; //!< Index of material in this instance
   double volume_{0.0};     //!< volume of cell instance in [cm^3]
+
+private:
+  //! Determine the material filling this cell instance and its volume
+  void init_material();
 };
 
 } // namespace enrico
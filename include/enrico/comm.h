@@ -4,12 +4,17 @@
 #define ENRICO_COMM_H
 
 #include "enrico/mpi_types.h"
+#include "enrico/trace.h"
 #include "xtensor/xtensor.hpp"
 
 #include <mpi.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace enrico {
@@ -56,7 +61,38 @@ public:
   //! Block until all processes have reached this call
   //!
   //! \return Error value
-  int Barrier() const { return MPI_Barrier(comm); }
+  int Barrier() const
+  {
+    TraceScope trace{"MPI_Barrier"};
+    return MPI_Barrier(comm);
+  }
+
+  //! Block until all processes have reached this call, sleeping while waiting
+  //!
+  //! MPI_Barrier typically busy-waits, which takes CPU time away from other
+  //! processes sharing the same cores. Here, the barrier is polled with an
+  //! exponentially increasing sleep in between.
+  //!
+  //! \return Error value
+  int idle_barrier() const
+  {
+    TraceScope trace{"idle_barrier"};
+    MPI_Request request;
+    int ierr = MPI_Ibarrier(comm, &request);
+
+    std::chrono::microseconds wait{10};
+    const std::chrono::microseconds max_wait{2000};
+    int done = 0;
+    while (ierr == MPI_SUCCESS) {
+      ierr = MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+      if (done) {
+        break;
+      }
+      std::this_thread::sleep_for(wait);
+      wait = std::min(2 * wait, max_wait);
+    }
+    return ierr;
+  }
 
   //! Broadcasts a message from the process with rank "root" to all other processes in
   //! this comm.
@@ -70,6 +106,7 @@ public:
   //! \return Error value
   int Bcast(void* buffer, int count, MPI_Datatype datatype, int root = 0) const
   {
+    TraceScope trace{"MPI_Bcast", count, datatype};
     return MPI_Bcast(buffer, count, datatype, root, comm);
   }
 
@@ -131,6 +168,7 @@ public:
              MPI_Datatype recvtype,
              int root = 0) const
   {
+    TraceScope trace{"MPI_Gather", sendcount, sendtype};
     return MPI_Gather(
       sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
   }
@@ -162,10 +200,41 @@ public:
               MPI_Datatype recvtype,
               int root = 0) const
   {
+    TraceScope trace{"MPI_Gatherv", sendcount, sendtype};
     return MPI_Gatherv(
       sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
   }
 
+  //! Scatters from specified locations of a given root to all processes
+  //!
+  //! Currently, a wrapper for MPI_Scatterv.
+  //!
+  //! \param[in] sendbuf Address of send buffer (significant only at root)
+  //! \param[in] sendcounts Integer array (of length group size) containing the number
+  //!                       of elements that are sent to each process
+  //! \param[in] displs Integer array (of length group size). Entry i specifies the
+  //!                   displacement relative to sendbuf from which to take the
+  //!                   outgoing data to process i.
+  //! \param[in] sendtype Data type of send buffer elements
+  //! \param[out] recvbuf Address of receive buffer
+  //! \param[in] recvcount Number of elements in receive buffer
+  //! \param[in] recvtype Data type of receive buffer elements
+  //! \param[in] root Rank of sending process
+  //! \return Error value
+  int Scatterv(const void* sendbuf,
+               const int sendcounts[],
+               const int displs[],
+               MPI_Datatype sendtype,
+               void* recvbuf,
+               int recvcount,
+               MPI_Datatype recvtype,
+               int root = 0) const
+  {
+    TraceScope trace{"MPI_Scatterv", recvcount, recvtype};
+    return MPI_Scatterv(
+      sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+  }
+
   //! Gathers data from all tasks and distribute the combined data to all tasks.
   //!
   //! Currently, a wrapper for MPI_Allgather
@@ -184,10 +253,33 @@ public:
                 int recvcount,
                 MPI_Datatype recvtype) const
   {
+    TraceScope trace{"MPI_Allgather", sendcount, sendtype};
     return MPI_Allgather(
       sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
   }
 
+  //! Reduces values from all processes in this comm onto a given root.
+  //!
+  //! Currently, a wrapper for MPI_Reduce.
+  //!
+  //! \param[in] sendbuf Starting address of send buffer (may be MPI_IN_PLACE at root)
+  //! \param[out] recvbuf Address of receive buffer (significant only at root)
+  //! \param[in] count Number of elements in send buffer
+  //! \param[in] datatype Data type of buffer elements
+  //! \param[in] op Reduction operation
+  //! \param[in] root Rank of root process
+  //! \return Error value
+  int Reduce(const void* sendbuf,
+             void* recvbuf,
+             int count,
+             MPI_Datatype datatype,
+             MPI_Op op,
+             int root = 0) const
+  {
+    TraceScope trace{"MPI_Reduce", count, datatype};
+    return MPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+  }
+
   //! Displays a message from rank 0
   //! \param A message to display
   void message(const std::string& msg) const
@@ -196,6 +288,14 @@ public:
       std::cout << "[ENRICO]: " << msg << std::endl;
   }
 
+  //! Displays a message from rank 0 without constructing a std::string
+  //! \param A message to display
+  void message(const char* msg) const
+  {
+    if (rank == 0)
+      std::cout << "[ENRICO]: " << msg << std::endl;
+  }
+
   // Data members
   MPI_Comm comm =
     MPI_COMM_NULL; //!< The MPI communicator described by this instance of Comm.
@@ -209,6 +309,7 @@ std::enable_if_t<std::is_scalar<std::decay_t<T>>::value>
 Comm::send_and_recv(T& value, int dest, int source) const
 {
   if (this->active() && dest != source) {
+    TraceScope trace{"send_and_recv", 1, get_mpi_type<T>()};
     int tag = source;
     if (rank == source) {
       MPI_Send(&value, 1, get_mpi_type<T>(), dest, tag, comm);
@@ -231,6 +332,7 @@ void Comm::send_and_recv(std::vector<T>& values, int dest, int source) const
     }
 
     // Send the vector
+    TraceScope trace{"send_and_recv", static_cast<int>(n), get_mpi_type<T>()};
     int tag = source;
     if (rank == source) {
       MPI_Send(values.data(), n, get_mpi_type<T>(), dest, tag, comm);
@@ -244,19 +346,31 @@ template<typename T, size_t N>
 void Comm::send_and_recv(xt::xtensor<T, N>& values, int dest, int source) const
 {
   if (this->active() && dest != source) {
-    // Make sure the shapes match
+    // Make sure the shapes match. The shape is sent in a fixed-size array so that
+    // nothing is allocated when the shapes already match.
+    int tag = source;
     const auto& s = values.shape();
-    std::vector<size_t> my_shape(s.begin(), s.end());
-    std::vector<size_t> root_shape(my_shape);
-    send_and_recv(root_shape, dest, source);
-    if (rank == dest && my_shape != root_shape) {
-      values.resize(root_shape);
+    std::array<size_t, N> root_shape;
+    std::copy(s.begin(), s.end(), root_shape.begin());
+    if (rank == source) {
+      MPI_Send(root_shape.data(), N, get_mpi_type<size_t>(), dest, tag, comm);
+    } else if (rank == dest) {
+      MPI_Recv(root_shape.data(),
+               N,
+               get_mpi_type<size_t>(),
+               source,
+               tag,
+               comm,
+               MPI_STATUS_IGNORE);
+      if (!std::equal(root_shape.begin(), root_shape.end(), s.begin())) {
+        values.resize(root_shape);
+      }
     }
     // Send the size
     auto n = values.size();
 
     // Finally, send data
-    int tag = source;
+    TraceScope trace{"send_and_recv", static_cast<int>(n), get_mpi_type<T>()};
     if (rank == source) {
       MPI_Send(values.data(), n, get_mpi_type<T>(), dest, tag, comm);
     } else if (rank == dest) {
@@ -293,13 +407,14 @@ template<typename T, size_t N>
 void Comm::broadcast(xt::xtensor<T, N>& values, int root) const
 {
   if (this->active()) {
-    // First, make sure shape of `values` matches root's
+    // First, make sure shape of `values` matches root's. The shape is broadcast in a
+    // fixed-size array so that nothing is allocated when the shapes already match.
     const auto& s = values.shape();
-    std::vector<size_t> my_shape(s.begin(), s.end());
-    std::vector<size_t> root_shape(my_shape);
+    std::array<size_t, N> root_shape;
+    std::copy(s.begin(), s.end(), root_shape.begin());
 
-    broadcast(root_shape, root);
-    if (my_shape != root_shape) {
+    Bcast(root_shape.data(), N, get_mpi_type<size_t>(), root);
+    if (!std::equal(root_shape.begin(), root_shape.end(), s.begin())) {
       values.resize(root_shape);
     }
 
@@ -1,6 +1,7 @@
 #ifndef ENRICO_COMM_SPLIT_H
 #define ENRICO_COMM_SPLIT_H
 
+#include "enrico/affinity.h"
 #include "enrico/comm.h"
 
 #include <array>
@@ -17,6 +18,9 @@ namespace enrico {
 //! \param[in] procs_per_node The desired number of procs/node for each single-physics
 //!            driver's new communicator.  If a value is <=, then the respective driver's
 //!            communicator will contain the maximum number of available procs/node
+//! \param[in] placement How the procs/node are chosen among the ranks on a node.  With
+//!            Placement::numa or Placement::socket, they are spread evenly over the
+//!            NUMA domains or sockets that the ranks are bound to
 //! \param[out] driver_comms The newly-created communicators, one for each driver.
 //!             Each is comm active on the calling rank if it's contained by the respective
 //!             driver; and null if not.
@@ -25,10 +29,61 @@ namespace enrico {
 void get_driver_comms(Comm super_comm,
                       std::array<int, 2> num_nodes,
                       std::array<int, 2> procs_per_node,
+                      Placement placement,
                       std::array<Comm, 2>& driver_comms,
                       Comm& intranode_comm,
                       Comm& coupling_comm);
 
+//! Joins the executables of an MPMD launch into communicators for each driver
+//!
+//! The first executable on the mpirun command line runs the neutronics driver and the
+//! second runs the heat-fluids driver, as identified by the MPI_APPNUM attribute. The
+//! ranks of each executable form a local comm; the two are connected with
+//! MPI_Intercomm_create, and the intercommunicator is merged so that the coupling
+//! layer can address all ranks, neutronics ranks first.
+//!
+//! \param[in] super_comm An existing communicator containing the ranks of both
+//!            executables, usually MPI_COMM_WORLD
+//! \param[out] driver_comms The local comm of the calling rank's executable in its
+//!             driver's position, and a null comm in the other position
+//! \param[out] intranode_comm A new comm that spans the node that the calling rank is in
+//! \param[out] coupled_comm A new comm containing the ranks of both executables
+void get_mpmd_comms(Comm super_comm,
+                    std::array<Comm, 2>& driver_comms,
+                    Comm& intranode_comm,
+                    Comm& coupled_comm);
+
+//! Get the number of threads per rank that fills the cores of a node
+//!
+//! The ranks on a node are assumed to be launched one per core. The cores of the node
+//! are divided evenly among the ranks of the given driver on that node, so that cores
+//! whose ranks are not in the driver are used by its threads. Must be called by all
+//! ranks of intranode_comm.
+//!
+//! \param[in] driver_comm A driver communicator from get_driver_comms
+//! \param[in] intranode_comm The comm spanning the node that the calling rank is in
+//! \return Number of threads for the calling rank if it is in the driver, otherwise 0
+int threads_per_rank(const Comm& driver_comm, const Comm& intranode_comm);
+
+//! Splits a driver's communicator into independent replicas of that driver
+//!
+//! Each replica receives a contiguous block of ranks from driver_comm, so replicas
+//! are laid out on contiguous nodes whenever driver_comm is.
+//!
+//! \param[in] driver_comm An existing driver communicator that will be split.  If it
+//!            is not active on the calling rank, all outputs are null.
+//! \param[in] n_replicas The desired number of replicas
+//! \param[out] replica_comm A new comm for the replica that contains the calling rank
+//! \param[out] replica_roots_comm A new comm containing the root of every replica.
+//!             It is null on ranks that are not the root of a replica.
+//! \param[out] replica_idx Index of the replica containing the calling rank, or -1 if
+//!             driver_comm is not active on the calling rank
+void get_replica_comms(Comm driver_comm,
+                       int n_replicas,
+                       Comm& replica_comm,
+                       Comm& replica_roots_comm,
+                       int& replica_idx);
+
 }
 
 #endif // ENRICO_COMM_SPLIT_H
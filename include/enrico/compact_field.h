@@ -0,0 +1,75 @@
+//! \file compact_field.h
+//! Reduced-precision representation of coupled fields for transfer between drivers
+#ifndef ENRICO_COMPACT_FIELD_H
+#define ENRICO_COMPACT_FIELD_H
+
+#include "enrico/comm.h"
+
+#include <gsl/gsl>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace enrico {
+
+//! Precision with which coupled fields are transferred between drivers
+enum class Precision {
+  full,   //!< 64-bit floating point, i.e., no conversion
+  single, //!< 32-bit floating point
+  fixed16 //!< 16-bit fixed point, scaled to the range of each component
+};
+
+//! Holds a field in a compact representation while it is transferred between
+//! drivers. Values are only converted for the transfer; they are encoded from and
+//! decoded to double precision.
+class CompactField {
+public:
+  CompactField() = default;
+
+  //! \param precision Precision of the transferred values; must not be full
+  //! \param n_components Number of interleaved components of the field. For
+  //!        fixed-point encodings, each component is scaled to its own range.
+  CompactField(Precision precision, int n_components);
+
+  //! Encode a field, recording the quantization error of each component
+  //! \param values Interleaved components of the field
+  void encode(gsl::span<const double> values);
+
+  //! Decode the field
+  //! \param[out] values Interleaved components of the field; must hold size() values
+  void decode(gsl::span<double> values) const;
+
+  //! Send the encoded field from one rank to another
+  //! \param comm Communicator containing both ranks
+  //! \param dest Destination rank
+  //! \param source Source rank
+  void send_and_recv(const Comm& comm, int dest, int source);
+
+  //! Broadcast the encoded field across ranks
+  //! \param comm Communicator to broadcast over
+  //! \param root Rank holding the encoded field
+  void broadcast(const Comm& comm, int root = 0);
+
+  //! Get the number of encoded values
+  //! \return Number of values, counting each component
+  std::size_t size() const;
+
+  //! Get the largest quantization error of a component in the most recent encode()
+  //! \param component Index of the component
+  //! \return Largest absolute difference between a decoded and an original value
+  double max_error(int component) const { return error_.at(component); }
+
+private:
+  Precision precision_{Precision::single}; //!< Precision of the transferred values
+  int n_components_{1};                    //!< Number of interleaved components
+  std::vector<float> single_;              //!< Values for single precision
+  std::vector<uint16_t> fixed_;            //!< Values for fixed-point precision
+  std::vector<double> offset_;             //!< Fixed-point offset of each component
+  std::vector<double> scale_;              //!< Fixed-point scale of each component
+  std::vector<double> error_;              //!< Quantization error of each component
+};
+
+} // namespace enrico
+
+#endif // ENRICO_COMPACT_FIELD_H
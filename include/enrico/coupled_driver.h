@@ -4,15 +4,23 @@
 #ifndef ENRICO_COUPLED_DRIVER_H
 #define ENRICO_COUPLED_DRIVER_H
 
+#include "enrico/affinity.h"
+#include "enrico/bit_mask.h"
+#include "enrico/compact_field.h"
 #include "enrico/driver.h"
+#include "enrico/field_history.h"
 #include "enrico/heat_fluids_driver.h"
 #include "enrico/neutronics_driver.h"
+#include "enrico/space_filling_curve.h"
+#include "enrico/surrogate_heat_driver.h"
 
 #include <pugixml.hpp>
 #include <xtensor/xtensor.hpp>
 
+#include <deque>
+#include <limits> // for numeric_limits
 #include <memory> // for unique_ptr
-#include <unordered_map>
+#include <string>
 #include <vector>
 
 namespace enrico {
@@ -29,6 +37,13 @@ public:
   //! while 'heat' sets temperature based on a thermal-fluids input (or restart) file.
   enum class Initial { neutronics, heat };
 
+  //! Enumeration of communicator layouts. 'partitioned' places the neutronics driver
+  //! on the left-hand nodes and the heat driver on the right-hand nodes, while
+  //! 'overlapping' places both drivers on all nodes so that they share cores. With
+  //! 'mpmd', the drivers are run by separate executables that are launched together
+  //! and joined by an intercommunicator.
+  enum class Communication { partitioned, overlapping, mpmd };
+
   //! Initializes coupled neutron transport and thermal-hydraulics solver with
   //! the given MPI communicator
   //!
@@ -46,15 +61,16 @@ public:
   //! \param relax Apply relaxation to heat source before updating heat solver
   void update_heat_source(bool relax);
 
-  //! Update the temperature for the neutronics solver
-  //!
-  //! \param relax Apply relaxation to temperature before updating neutronics solver
-  void update_temperature(bool relax);
+  //! Run the heat driver for one Picard iteration. With subcycling, the heat driver
+  //! takes several sub-steps, and the temperature and density are averaged over them.
+  void solve_heat();
 
-  //! Update the density for the neutronics solver
+  //! Update the temperature and density for the neutronics solver. Both fields are
+  //! gathered from the heat driver and sent to the neutronics ranks together.
   //!
-  //! \param relax Apply relaxation to density before updating neutronics solver
-  void update_density(bool relax);
+  //! \param relax Apply relaxation to temperature and density before updating
+  //!              neutronics solver
+  void update_fields(bool relax);
 
   //! Check convergence of the coupled solve for the current Picard iteration.
   bool is_converged();
@@ -64,13 +80,28 @@ public:
   //! \return norm of the temperature between two iterations
   double temperature_norm(Norm n);
 
+  //! Compute the norm of the density between two successive Picard iterations
+  //! \param norm enumeration of norm to compute
+  //! \return norm of the density between two iterations
+  double density_norm(Norm n);
+
+  //! Compute the norm of the heat source between two successive Picard iterations,
+  //! relative to the norm of the current heat source
+  //! \param norm enumeration of norm to compute
+  //! \return relative norm of the heat source between two iterations
+  double heat_source_norm(Norm n);
+
   //! Get reference to neutronics driver
   //! \return reference to driver
   NeutronicsDriver& get_neutronics_driver() const { return *neutronics_driver_; }
 
-  //! Get reference to thermal-fluids driver
+  //! Get reference to the thermal-fluids driver currently used for coupling. In
+  //! multi-fidelity mode, this is the surrogate driver until the handoff.
   //! \return reference to driver
-  HeatFluidsDriver& get_heat_driver() const { return *heat_fluids_driver_; }
+  HeatFluidsDriver& get_heat_driver() const
+  {
+    return surrogate_active_ ? *surrogate_driver_ : *heat_fluids_driver_;
+  }
 
   //! Get timestep iteration index
   //! \return timestep iteration index
@@ -94,9 +125,52 @@ public:
 
   int max_picard_iter_; //!< Maximum number of Picard iterations
 
+  //! Length of each coupled timestep in [s]. If zero, the drivers are not told about
+  //! the timestep and each keeps its own notion of time.
+  double dt_{0.0};
+
+  double time_{0.0}; //!< Physical time at the start of the current timestep in [s]
+
+  //! Time at which the coupled simulation ends in [s]. The simulation also ends after
+  //! max_timesteps_ timesteps.
+  double end_time_{std::numeric_limits<double>::infinity()};
+
+  //! Whether the length of each timestep is adapted to how many Picard iterations
+  //! the previous timestep needed
+  bool adaptive_dt_{false};
+
+  double dt_min_;             //!< Shortest adaptive timestep in [s]
+  double dt_max_;             //!< Longest adaptive timestep in [s]
+  double dt_grow_{1.5};       //!< Factor by which an easy timestep is lengthened
+  double dt_shrink_{0.5};     //!< Factor by which a failed timestep is shortened
+  int dt_fast_iterations_{2}; //!< Picard iterations below which a timestep is easy
+
+  //! Whether all drivers can repeat a timestep from its start
+  bool can_repeat_timestep_{true};
+
+  //! Number of sub-steps the heat driver takes in each coupled timestep
+  int heat_subcycles_{1};
+
+  //! Whether the heat source of the sub-steps is interpolated in time between the
+  //! previous timestep and the current iterate, rather than held constant
+  bool interpolate_heat_source_{false};
+
   //! Picard iteration convergence tolerance, defaults to 1e-3 if not set
   double epsilon_{1e-3};
 
+  //! Picard iteration convergence tolerance on the density. The density is not checked
+  //! if not set.
+  double epsilon_rho_{std::numeric_limits<double>::infinity()};
+
+  //! Picard iteration convergence tolerance on the relative change of the heat source.
+  //! The heat source is not checked if not set.
+  double epsilon_q_{std::numeric_limits<double>::infinity()};
+
+  //! Number of standard deviations of the change of the heat source within which
+  //! every change is considered statistically insignificant, which satisfies the
+  //! heat source criterion. The test is disabled if set to 0 (the default).
+  double heat_source_noise_{0.0};
+
   //! Constant relaxation factor for the heat source,
   //! defaults to 1.0 (standard Picard) if not set
   double alpha_{1.0};
@@ -109,6 +183,25 @@ public:
   //! relaxation applied to the heat source if not set
   double alpha_rho_{alpha_};
 
+  //! Lower bound on the Aitken dynamic relaxation factor, defaults to 0.1
+  double alpha_min_{0.1};
+
+  //! Upper bound on the Aitken dynamic relaxation factor, defaults to 1.0. This is
+  //! also the relaxation factor used on the first relaxed iteration of each timestep.
+  double alpha_max_{1.0};
+
+  //! Layout of the driver communicators. In the overlapping and MPMD layouts, ranks
+  //! waiting for the other driver sleep rather than spin. Defaults to partitioned.
+  Communication communication_{Communication::partitioned};
+
+  //! How the ranks on each node that join a driver are chosen. Defaults to the lowest
+  //! node-local ranks.
+  Placement placement_{Placement::rank};
+
+  //! How neutronics cells are numbered for coupling. Defaults to the order in which
+  //! the neutronics driver finds them.
+  CellOrder cell_order_{CellOrder::find};
+
   //! Where to obtain the temperature initial condition from. Defaults to the
   //! temperatures in the neutronics input file.
   Initial temperature_ic_{Initial::neutronics};
@@ -117,6 +210,60 @@ public:
   //! in the neutronics input file.
   Initial density_ic_{Initial::neutronics};
 
+  //! Number of independent replicas of the neutronics driver. Each replica runs on
+  //! its own block of the neutronics ranks with a different random number seed, and
+  //! their heat sources are combined on the neutronics root. Defaults to 1.
+  int n_replicas_{1};
+
+  //! Order of the polynomial extrapolation used to predict the temperature, density,
+  //! and heat source at the start of each timestep from the converged fields of
+  //! previous timesteps. Valid orders are 0 (no predictor), 1 (linear), and 2
+  //! (quadratic). Defaults to 0.
+  int predictor_order_{0};
+
+  //! Relative change of the heat source, cell temperature, and cell density below
+  //! which a neutronics cell is considered settled. Frozen cells skip averaging,
+  //! setting, and transfer of coupling fields. Freezing is disabled if set to 0 (the
+  //! default).
+  double freeze_tolerance_{0.0};
+
+  //! Number of consecutive settled Picard iterations after which a cell is frozen,
+  //! defaults to 3
+  int freeze_iterations_{3};
+
+  //! Interval in Picard iterations at which all cells are updated regardless of
+  //! whether they are frozen, defaults to 10
+  int freeze_refresh_{10};
+
+  //! Norm of the temperature change below which the coupled solve switches from the
+  //! surrogate to the high-fidelity heat driver in multi-fidelity mode
+  double handoff_epsilon_;
+
+  //! Maximum number of Picard iterations performed with the surrogate heat driver in
+  //! multi-fidelity mode, defaults to half of the maximum number of Picard iterations
+  int max_surrogate_iter_;
+
+  //! Precision with which temperature, density, and heat source are transferred
+  //! between drivers. Computation and relaxation always use double precision.
+  //! Defaults to full (double) precision.
+  Precision transfer_precision_{Precision::full};
+
+  //! Path of the Chrome trace file written at the end of execute(). Empty if tracing
+  //! is disabled, which is the default.
+  std::string trace_file_;
+
+  //! Number of events held by the trace buffer of each thread
+  std::size_t trace_events_{100000};
+
+  //! Whether to display the memory used by each driver's ranks after each
+  //! initialization phase and the first solve, as well as the memory held by the
+  //! coupling data structures. Defaults to false.
+  bool memory_report_{false};
+
+  //! Path of the parallel HDF5 file that records the coupled fields and norms of each
+  //! Picard iteration. Empty if no history is written, which is the default.
+  std::string history_file_;
+
 private:
   //! Create bidirectional mappings from neutronics cell instances to/from TH elements
   void init_mappings();
@@ -145,12 +292,236 @@ private:
   //! this method does not set any initial values.
   void init_heat_source();
 
+  //! Size the exchange buffers and the Aitken residuals
+  void init_buffers();
+
+  //! Build the mapping from neutronics cells to the elements of the heat driver
+  //! currently used for coupling
+  void init_cell_to_elems();
+
+  //! Renumber the neutronics cells along a space-filling curve through their
+  //! centroids, so that cells close in space have nearby handles
+  //! \param elem_centroids Centroids of the global elements
+  void reorder_cells(const std::vector<Position>& elem_centroids);
+
+  //! Switch from the surrogate to the high-fidelity heat driver, mapping the surrogate
+  //! temperature and density onto the high-fidelity elements
+  void handoff_to_high_fidelity();
+
+  //! Gather a field from the high-fidelity heat driver onto the heat root. In
+  //! multi-fidelity mode, the same field from the surrogate heat driver is appended.
+  //! \param field Heat driver method returning the field
+  //! \return Field for all elements
+  template<typename T>
+  std::vector<T> gather_heat_field(
+    std::vector<T> (HeatFluidsDriver::*field)() const) const;
+
+  //! Get the offset of the elements of the heat driver currently used for coupling in
+  //! element-indexed fields
+  //! \return Index of the first element
+  int32_t active_heat_offset() const;
+
+  //! Get the number of elements of the heat driver currently used for coupling
+  //! \return Number of elements
+  int32_t n_active_heat_elem() const;
+
+  //! Get the segment of an element field belonging to the heat driver currently used
+  //! for coupling
+  //! \param field Element field in gather order
+  //! \return Segment of the field on the heat root; empty on other ranks
+  gsl::span<double> active_heat_segment(xt::xtensor<double, 1>& field) const;
+
+  //! Get the TH elements of a neutronics cell
+  //! \param cell Neutronics cell handle
+  //! \return Elements of the cell in ascending order
+  gsl::span<const int32_t> cell_elems(CellHandle cell) const
+  {
+    return gsl::span<const int32_t>(cell_elems_.data() + cell_elem_offsets_[cell],
+                                    cell_elems_.data() + cell_elem_offsets_[cell + 1]);
+  }
+
+  //! Whether a cell's temperature or density is updated from the element fields
+  //! \param cell Neutronics cell handle
+  //! \param fluid_only Whether only cells in fluid are updated
+  //! \return True if the cell has elements, is not frozen, and passes the fluid filter
+  bool is_cell_updated(CellHandle cell, bool fluid_only) const;
+
+  //! Compute volume averages of an element field over each neutronics cell.
+  //!
+  //! Cells are averaged concurrently with OpenMP threads when enabled.
+  //! \param field Element field in gather order
+  //! \param fluid_only Whether to skip cells that are not in fluid
+  //! \param[out] averages Average for each cell handle; cells that are not updated
+  //!             are left unchanged
+  void cell_averages(const xt::xtensor<double, 1>& field,
+                     bool fluid_only,
+                     std::vector<double>& averages) const;
+
+  //! Unfreeze all neutronics cells and reset their convergence tracking
+  void reset_frozen_cells();
+
+  //! Track the change of each neutronics cell in the current Picard iteration and
+  //! determine which cells are frozen for the next one
+  void update_frozen_cells();
+
+  //! Send the current temperature and density from the heat root to all neutronics
+  //! ranks in a single message and set the volume-averaged temperature and density
+  //! of each neutronics cell
+  void send_fields();
+
+  //! Set the volume-averaged temperature of each neutronics cell that is not frozen
+  void set_cell_temperatures();
+
+  //! Set the volume-averaged density of each neutronics fluid cell that is not frozen
+  void set_cell_densities();
+
+  //! Tell the drivers about the coming timestep and save their states, so that each
+  //! Picard iteration can start from the same state. With adaptive timesteps, the
+  //! coupled fields are saved as well.
+  void begin_timestep();
+
+  //! Restore the states of the drivers saved at the start of the timestep
+  void repeat_timestep();
+
+  //! Restore the coupled fields saved at the start of a rejected timestep and send
+  //! the temperature and density to the neutronics solver
+  void restore_fields();
+
+  //! Decide whether to accept the current timestep and choose the length of the next
+  //! timestep, or of the repeated one if the timestep is rejected
+  //! \param converged Whether the Picard iteration converged
+  //! \param n_iterations Number of Picard iterations taken
+  //! \return Whether the timestep is accepted
+  bool adapt_timestep(bool converged, int n_iterations);
+
+  //! Set the heat source of the local elements of the heat driver from the heat
+  //! source of the neutronics cells
+  //! \param weight Weight of the current heat source. The rest of the weight is given
+  //!               to the heat source of the previous timestep, if there is one.
+  void set_element_heat_source(double weight);
+
+  //! Save the converged fields of the current timestep for use by the predictor
+  //! \param dt Length of the current timestep in [s]
+  void save_field_history(double dt);
+
+  //! Get the time at the end of the current timestep, at which the predictor takes
+  //! the converged fields to hold
+  //! \param dt Length of the current timestep in [s]
+  //! \return End time in [s]. Without a timestep length, timesteps are taken to be of
+  //!         equal length and the number of timesteps at the end is returned instead.
+  double predictor_time(double dt) const
+  {
+    return dt > 0.0 ? time_ + dt : i_timestep_ + 1;
+  }
+
+  //! Extrapolate the fields for a new timestep from the converged fields of previous
+  //! timesteps and send the predicted temperature and density to the neutronics solver
+  void predict_fields();
+
+  //! Combine the heat sources from all neutronics replicas onto the neutronics root,
+  //! weighting each replica by its number of realizations
+  void reduce_replica_heat_source();
+
+  //! Broadcast a field from the neutronics root to all neutronics ranks in all
+  //! replicas
+  //! \param values Values to broadcast (significant at the neutronics root)
+  template<typename T>
+  void neutronics_broadcast(T& values) const;
+
+  //! State of the Aitken dynamic relaxation of one field
+  struct AitkenState {
+    xt::xtensor<double, 1> residual; //!< Residual of the previous Picard iteration
+    double alpha;                    //!< Relaxation factor of the previous iteration
+    bool has_residual = false;       //!< Whether residual holds a previous residual
+  };
+
+  //! Scratch buffers reused by the field exchange in every Picard iteration. They are
+  //! sized once by init_buffers() so that the exchange does not allocate memory.
+  struct ExchangeBuffers {
+    std::vector<double> cell_values;         //!< Volume averages over neutronics cells
+    std::vector<ElementFields> elem_fields;  //!< Temperature and density records
+    std::vector<ElementFields> subcycle_sum; //!< Records summed over heat sub-steps
+  };
+
+  //! Apply underrelaxation to a field
+  //! \param field Current unrelaxed iterate; overwritten with the relaxed iterate
+  //! \param prev Previous Picard iterate
+  //! \param alpha Relaxation factor or one of the special values ROBBINS_MONRO or AITKEN
+  //! \param aitken Aitken relaxation state of the field
+  //! \return Relaxation factor that was applied
+  double relax_field(xt::xtensor<double, 1>& field,
+                     const xt::xtensor<double, 1>& prev,
+                     double alpha,
+                     AitkenState& aitken) const;
+
+  //! Compute the Aitken relaxation factor from the residuals of the current and
+  //! previous Picard iterations, clamped to [alpha_min_, alpha_max_]
+  //! \param field Current unrelaxed iterate
+  //! \param prev Previous Picard iterate
+  //! \param aitken Aitken relaxation state of the field, updated in place
+  //! \return Relaxation factor for the current iteration
+  double aitken_factor(const xt::xtensor<double, 1>& field,
+                       const xt::xtensor<double, 1>& prev,
+                       AitkenState& aitken) const;
+
+  //! Broadcast the dynamic relaxation factor chosen for a field and display it
+  //! \param name Name of the field
+  //! \param alpha Relaxation factor (significant at root)
+  //! \param root Rank in comm_ that relaxed the field
+  void report_relaxation(const char* name, double alpha, int root) const;
+
+  //! Broadcast the quantization error of a reduced-precision transfer and display it
+  //! \param name Name of the field
+  //! \param error Largest quantization error (significant at root)
+  //! \param root Rank in comm_ that encoded the field
+  void report_transfer_error(const char* name, double error, int root) const;
+
+  //! Compute a norm of a field
+  //! \param values Field values, possibly an unevaluated expression
+  //! \param norm enumeration of norm to compute
+  //! \return Norm of the field
+  template<class E>
+  static double compute_norm(const xt::xexpression<E>& values, Norm norm);
+
+  //! Compute the largest change of the tallied heat source from the previous Picard
+  //! iterate in units of the standard deviation of the change, i.e., sqrt(2) times
+  //! the tally standard deviation, on the neutronics root. Must be called before the
+  //! heat source is underrelaxed.
+  //! \return Largest change in standard deviations, or infinity if the heat source
+  //!         has no statistical uncertainty
+  double heat_source_noise_ratio() const;
+
   //! Print report of communicator layout
   void comm_report();
 
+  //! Write the relaxed fields and norms of the current Picard iteration to the history
+  //! file, if there is one
+  void write_history();
+
+  //! Scatter an element field from the heat root to the heat ranks, each of which
+  //! writes the values of its local elements to the history
+  //! \param name Name of the dataset
+  //! \param field Element field in gather order (significant at the heat root)
+  void write_history_elem_field(const char* name, const xt::xtensor<double, 1>& field);
+
+  //! Display the memory used by the ranks of each driver, if memory_report_ is set
+  //! \param phase Description of the point in the run
+  void memory_checkpoint(const char* phase) const;
+
+  //! Display the bytes held by the coupling data structures and driver arrays, if
+  //! memory_report_ is set
+  void report_data_memory() const;
+
+  //! Wait until all ranks in comm_ reach this point. Unless the layout is partitioned,
+  //! waiting ranks sleep so that the active driver has the full CPU.
+  void barrier() const;
+
   //! Special alpha value indicating use of Robbins-Monro relaxation
   constexpr static double ROBBINS_MONRO = -1.0;
 
+  //! Special alpha value indicating use of Aitken dynamic relaxation
+  constexpr static double AITKEN = -2.0;
+
   int i_timestep_; //!< Index pertaining to current timestep
 
   int i_picard_; //!< Index pertaining to current Picard iteration
@@ -161,6 +532,14 @@ private:
   //! The rank in comm_ that corresponds to the root of the heat comm
   int heat_root_ = MPI_PROC_NULL;
 
+  //! Index of the neutronics replica containing this rank, or -1 if this rank does
+  //! not run the neutronics driver
+  int i_replica_ = -1;
+
+  //! Comm containing the root of each neutronics replica. Rank 0 of this comm is the
+  //! neutronics root.
+  Comm replica_roots_comm_;
+
   //! Current Picard iteration temperature; this temperature is the temperature
   //! computed by the thermal-hydraulic solver, and data mappings may result in
   //! a different temperature actually used in the neutronics solver. For example,
@@ -188,32 +567,151 @@ private:
 
   xt::xtensor<double, 1> heat_source_prev_; //!< Previous Picard iteration heat source
 
+  //! Heat source of the previous timestep on the heat ranks, from which the heat
+  //! source of the sub-steps is interpolated. Empty in the first timestep.
+  xt::xtensor<double, 1> heat_source_start_;
+
+  //! Standard deviation of the current Picard iteration heat source, as estimated by
+  //! the neutronics solver before underrelaxation
+  xt::xtensor<double, 1> heat_source_std_dev_;
+
+  //! Largest change of the tallied heat source in the current Picard iteration in
+  //! standard deviations, on all ranks; see heat_source_noise_ratio()
+  double heat_source_noise_ratio_{std::numeric_limits<double>::infinity()};
+
+  //! Coupled fields at the start of a timestep, from which a rejected timestep is
+  //! repeated. They are only saved with adaptive timesteps, on the root holding each
+  //! field.
+  struct TimestepStart {
+    xt::xtensor<double, 1> temperatures;      //!< Temperature on the heat root
+    xt::xtensor<double, 1> temperatures_prev; //!< Previous temperature iterate
+    xt::xtensor<double, 1> densities;         //!< Density on the heat root
+    xt::xtensor<double, 1> densities_prev;    //!< Previous density iterate
+    xt::xtensor<double, 1> heat_source;       //!< Heat source on the neutronics root
+    xt::xtensor<double, 1> heat_source_prev;  //!< Previous heat source iterate
+  };
+  TimestepStart timestep_start_; //!< Coupled fields at the start of the timestep
+
+  AitkenState aitken_q_;   //!< Aitken relaxation state of the heat source
+  AitkenState aitken_T_;   //!< Aitken relaxation state of the temperature
+  AitkenState aitken_rho_; //!< Aitken relaxation state of the density
+
+  ExchangeBuffers buffers_; //!< Scratch buffers of the field exchange
+
+  //! Temperature and density records in reduced precision during transfer
+  CompactField compact_fields_;
+
+  //! Heat source in reduced precision during transfer
+  CompactField compact_heat_source_;
+
+  //! Norm of the temperature change in the most recent Picard iteration
+  double temperature_norm_;
+
+  //! Norm of the density change in the most recent Picard iteration
+  double density_norm_;
+
+  //! Relative norm of the heat source change in the most recent Picard iteration
+  double heat_source_norm_;
+
+  //! History file of the coupled fields, or null if none is written
+  std::unique_ptr<FieldHistory> history_;
+
+  //! Values of an element field for the local elements of the heat drivers, which
+  //! are scattered from the heat root to write them to the history
+  std::vector<double> history_values_;
+
+  //! Converged temperatures of previous timesteps on the heat root, most recent first
+  std::deque<xt::xtensor<double, 1>> temperature_history_;
+
+  //! Converged densities of previous timesteps on the heat root, most recent first
+  std::deque<xt::xtensor<double, 1>> density_history_;
+
+  //! Converged heat sources of previous timesteps on the neutronics root, most recent
+  //! first
+  std::deque<xt::xtensor<double, 1>> heat_source_history_;
+
+  //! Times of the converged fields of previous timesteps, as given by
+  //! predictor_time(), on all ranks, most recent first
+  std::deque<double> time_history_;
+
   std::unique_ptr<NeutronicsDriver> neutronics_driver_;  //!< The neutronics driver
   std::unique_ptr<HeatFluidsDriver> heat_fluids_driver_; //!< The heat-fluids driver
 
+  //! Surrogate heat-fluids driver used as a predictor for the high-fidelity heat
+  //! driver in multi-fidelity mode; null otherwise
+  std::unique_ptr<SurrogateHeatDriver> surrogate_driver_;
+
+  //! Whether the surrogate heat driver is currently used for coupling
+  bool surrogate_active_ = false;
+
+  //! Number of global elements in the high-fidelity heat driver. In multi-fidelity
+  //! mode, the elements of the surrogate heat driver follow these elements in all
+  //! element-indexed fields.
+  int32_t n_hifi_elem_;
+
+  //! For each high-fidelity element, the surrogate element containing its centroid,
+  //! or -1 if there is none (multi-fidelity mode on the heat root only)
+  std::vector<int32_t> hifi_to_surrogate_;
+
   //! States whether a global element is in the fluid region
   //! These are **not** ordered by TH global element indices.  Rather, these are
   //! ordered according to an MPI_Gatherv operation on TH local elements.
-  std::vector<int> elem_fluid_mask_;
+  BitMask elem_fluid_mask_;
 
   //! States whether a neutronic cell is in the fluid region
-  xt::xtensor<int, 1> cell_fluid_mask_;
+  BitMask cell_fluid_mask_;
+
+  //! Handles of the neutronics cells in the fluid region that have TH elements, in
+  //! ascending order. The density update only visits these cells.
+  std::vector<CellHandle> fluid_cells_;
 
   //! Volumes of global elements in TH solver
   //! These are **not** ordered by TH global element indices.  Rather, these are
   //! ordered according to an MPI_Gatherv operation on TH local elements.
   std::vector<double> elem_volumes_;
 
-  //! Map that gives a list of TH element indices for a given neutronics cell
-  //! handle. The TH element indices refer to indices defined by the MPI_Gatherv
-  //! operation, and do not reflect TH internal global element indexing.
-  std::unordered_map<CellHandle, std::vector<int32_t>> cell_to_elems_;
+  //! TH element indices ordered by neutronics cell, so that the elements of each cell
+  //! are contiguous (see cell_elems()). The TH element indices refer to indices defined
+  //! by the MPI_Gatherv operation, and do not reflect TH internal global element
+  //! indexing. Only elements of the heat driver currently used for coupling are
+  //! included, so cells without such elements have an empty range.
+  std::vector<int32_t> cell_elems_;
+
+  //! Offset of the elements of each neutronics cell in cell_elems_, indexed by cell
+  //! handle, followed by the total number of elements
+  std::vector<int32_t> cell_elem_offsets_;
 
   //! Map that gives the neutronics cell handle for a given TH element index.
   //! The TH element indices refer to indices defined by the MPI_Gatherv
   //! operation, and do not reflect TH internal global element indexing.
   std::vector<CellHandle> elem_to_cell_;
 
+  //! States whether each neutronics cell is frozen, i.e., skipped when updating
+  //! coupling fields. Significant on all ranks.
+  BitMask cell_frozen_;
+
+  //! Number of frozen neutronics cells
+  int n_frozen_cells_ = 0;
+
+  //! Number of consecutive settled Picard iterations of each neutronics cell (on the
+  //! neutronics root only)
+  std::vector<int> cell_settled_iters_;
+
+  //! Temperature most recently set in each neutronics cell (when freezing is enabled)
+  xt::xtensor<double, 1> cell_temperatures_;
+
+  //! Cell temperatures at the previous check for frozen cells (on the neutronics root
+  //! only)
+  xt::xtensor<double, 1> cell_temperatures_prev_;
+
+  //! Density most recently set in each neutronics fluid cell (when freezing is
+  //! enabled); zero in cells that are not in fluid
+  xt::xtensor<double, 1> cell_densities_;
+
+  //! Cell densities at the previous check for frozen cells (on the neutronics root
+  //! only)
+  xt::xtensor<double, 1> cell_densities_prev_;
+
   //! Number of unique cells in neutronics model
   int32_t n_cells_;
 
@@ -224,6 +722,26 @@ private:
   Norm norm_{Norm::LINF};
 };
 
+template<typename T>
+void CoupledDriver::neutronics_broadcast(T& values) const
+{
+  // Send to the root of each replica first, then to the ranks within each replica
+  replica_roots_comm_.broadcast(values);
+  this->get_neutronics_driver().comm_.broadcast(values);
+}
+
+template<typename T>
+std::vector<T> CoupledDriver::gather_heat_field(
+  std::vector<T> (HeatFluidsDriver::*field)() const) const
+{
+  auto values = ((*heat_fluids_driver_).*field)();
+  if (surrogate_driver_) {
+    auto surrogate_values = ((*surrogate_driver_).*field)();
+    values.insert(values.end(), surrogate_values.begin(), surrogate_values.end());
+  }
+  return values;
+}
+
 } // namespace enrico
 
 #endif // ENRICO_COUPLED_DRIVER_H
@@ -8,6 +8,7 @@
 
 #include <mpi.h>
 
+#include <cstddef>
 #include <vector>
 
 namespace enrico {
@@ -38,6 +39,29 @@ public:
   //! Performs the necessary finalization for this solver in one Picard iteration
   virtual void finalize_step() {}
 
+  //! Set the interval of physical time that each solve_step() of the coming coupled
+  //! timestep advances over. Drivers that solve steady-state problems ignore it.
+  //! \param time Time at the start of the timestep in [s]
+  //! \param dt Length of the timestep in [s]
+  virtual void set_timestep(double time, double dt) {}
+
+  //! Save the state of the solver at the start of a coupled timestep
+  virtual void save_state() {}
+
+  //! Restore the state saved by save_state() so that the next solve_step() repeats
+  //! the timestep from its start
+  virtual void restore_state() {}
+
+  //! Whether the driver can repeat a timestep from the state saved by save_state().
+  //! This holds trivially for drivers that solve steady-state problems.
+  //! \return Whether the driver can repeat a timestep
+  virtual bool can_repeat_timestep() const { return true; }
+
+  //! Get the bytes held by the driver's own arrays on the calling rank. Memory owned
+  //! by the underlying solver library is not included unless noted by the driver.
+  //! \return Number of bytes
+  virtual std::size_t memory_bytes() const { return 0; }
+
   //! Queries whether the comm for this solver is active
   //! \return True if this comm's solver is not MPI_COMM_NULL
   bool active() const;
@@ -0,0 +1,17 @@
+//! \file element_fields.h
+//! Fields of a heat/fluids element that are sent to the neutronics solver
+#ifndef ENRICO_ELEMENT_FIELDS_H
+#define ENRICO_ELEMENT_FIELDS_H
+
+namespace enrico {
+
+//! Packs the feedback fields of one heat/fluids element so that all of them can be
+//! moved with a single message
+struct ElementFields {
+  double temperature{}; //!< Temperature in [K]
+  double density{};     //!< Density in [g/cm^3]
+};
+
+} // namespace enrico
+
+#endif // ENRICO_ELEMENT_FIELDS_H
@@ -0,0 +1,89 @@
+//! \file field_history.h
+//! Parallel HDF5 record of the coupled fields in each Picard iteration
+#ifndef ENRICO_FIELD_HISTORY_H
+#define ENRICO_FIELD_HISTORY_H
+
+#include "enrico/comm.h"
+
+#include <gsl/gsl>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace enrico {
+
+//! Writes the coupled fields of each Picard iteration to an HDF5 file in parallel
+//!
+//! The fields of timestep t and Picard iteration i are written to the group
+//! /timestep_<t>/iteration_<i>, with one dataset per field and one attribute per
+//! scalar. When a rejected timestep is repeated, the groups of its earlier attempt
+//! are replaced, so the file holds the iterations of the accepted attempt. All
+//! methods are collective over the communicator the file was opened with. Each field
+//! is written by the ranks of a given writer communicator, each of which writes its
+//! own disjoint segments of the field, so that no rank needs to gather the field.
+class FieldHistory {
+public:
+  //! A contiguous segment of a field
+  struct Segment {
+    std::size_t offset; //!< Index of the first value of the segment in the field
+    std::size_t size;   //!< Number of values in the segment
+  };
+
+  //! Create the history file, overwriting any existing file
+  //! \param comm Communicator containing all ranks that call the methods
+  //! \param filename Path of the file
+  FieldHistory(const Comm& comm, const std::string& filename);
+
+  //! Close the history file
+  ~FieldHistory();
+
+  FieldHistory(const FieldHistory&) = delete;
+  FieldHistory& operator=(const FieldHistory&) = delete;
+
+  //! Create the group for a timestep and Picard iteration, which receives the
+  //! fields and scalars until end_iteration() is called. The first iteration of a
+  //! timestep removes any groups left by an earlier attempt of the timestep.
+  //! \param timestep Index of the timestep
+  //! \param iteration Index of the Picard iteration
+  void begin_iteration(int timestep, int iteration);
+
+  //! Write a field to the current iteration, of which each writer holds the whole
+  //! field and writes a contiguous slab
+  //! \param name Name of the dataset
+  //! \param values Whole field; only significant on ranks where writers is active
+  //! \param global_size Number of values in the field, which must be given on all ranks
+  //! \param writers Communicator of the ranks that write the field
+  void write_field(const char* name,
+                   gsl::span<const double> values,
+                   std::size_t global_size,
+                   const Comm& writers);
+
+  //! Write a field to the current iteration, of which each writer holds segments
+  //! \param name Name of the dataset
+  //! \param values Values of the segments of this rank, in order of the segments
+  //! \param segments Segments of the field written by this rank, which must not
+  //!        overlap those of other ranks; empty on ranks that do not write
+  //! \param global_size Number of values in the field, which must be given on all ranks
+  void write_field(const char* name,
+                   gsl::span<const double> values,
+                   const std::vector<Segment>& segments,
+                   std::size_t global_size);
+
+  //! Write a scalar as an attribute of the current iteration
+  //! \param name Name of the attribute
+  //! \param value Value, which must be the same on all ranks
+  void write_scalar(const char* name, double value);
+
+  //! Close the group of the current iteration
+  void end_iteration();
+
+private:
+  std::int64_t file_{-1};  //!< HDF5 identifier of the file
+  std::int64_t group_{-1}; //!< HDF5 identifier of the current iteration's group
+};
+
+} // namespace enrico
+
+#endif // ENRICO_FIELD_HISTORY_H
@@ -4,12 +4,15 @@
 #define HEAT_FLUIDS_DRIVER_H
 
 #include "enrico/driver.h"
+#include "enrico/element_fields.h"
 #include "enrico/geom.h"
 #include "enrico/mpi_types.h"
 #include "pugixml.hpp"
 #include "xtensor/xtensor.hpp"
+#include <gsl/gsl>
 
 #include <cstddef> // for size_t
+#include <vector>
 
 namespace enrico {
 
@@ -35,10 +38,39 @@ public:
   //! \return Density in each region as [g/cm^3]
   xt::xtensor<double, 1> density() const;
 
-  //! States whether each region is in fluid
+  //! Get the temperature in each region without allocating memory
+  //! \param[out] global Temperature in each region as [K]. Only significant on the
+  //!             root, where it must hold n_global_elem() values.
+  void temperature(gsl::span<double> global);
+
+  //! Get the density in each region without allocating memory
+  //! \param[out] global Density in each region as [g/cm^3]. Only significant on the
+  //!             root, where it must hold n_global_elem() values.
+  void density(gsl::span<double> global);
+
+  //! Get the temperature and density in each region with a single local pass and a
+  //! single gather
+  //! \param[out] global Fields of each region. Only significant on the root, where it
+  //!             must hold n_global_elem() values.
+  void fields(gsl::span<ElementFields> global);
+
+  //! States whether each region is in fluid. Each call gathers the cached local
+  //! values anew; only the local values are cached.
   //! \return For each region, 1 if region is in fluid and 0 otherwise
   std::vector<int> fluid_mask() const;
 
+  //! States whether each local region is in fluid. The values are computed once and
+  //! cached until the geometry is invalidated.
+  //! \return For each local region, 1 if region is in fluid and 0 otherwise
+  gsl::span<const int> local_fluid_mask() const;
+
+  //! Set the heat source in a given local element
+  //!
+  //! The coupled driver may call this concurrently from multiple OpenMP threads for
+  //! distinct elements, so implementations must not modify shared state.
+  //! \param local_elem Local element index
+  //! \param heat Volumetric heat source
+  //! \return Error code
   virtual int set_heat_source_at(int32_t local_elem, double heat) = 0;
 
   //! Get the number of local mesh elements
@@ -49,14 +81,30 @@ public:
   //! \return Number of global mesh elements
   virtual std::size_t n_global_elem() const = 0;
 
-  //! Get the centroids of all mesh elements
+  //! Get the centroids of all mesh elements. Each call gathers the cached local
+  //! values anew; only the local values are cached.
   //! \return Vector of all centroids
   std::vector<Position> centroids() const;
 
-  //! Get the volumes of all mesh elements
+  //! Get the centroids of local mesh elements. The values are computed once and
+  //! cached until the geometry is invalidated.
+  //! \return Centroids of local mesh elements
+  gsl::span<const Position> local_centroids() const;
+
+  //! Get the bytes held by the gather counts, displacements, and buffers
+  //! \return Number of bytes
+  std::size_t memory_bytes() const override;
+
+  //! Get the volumes of all mesh elements. Each call gathers the cached local values
+  //! anew; only the local values are cached.
   //! \return Vector of all volumes
   std::vector<double> volumes() const;
 
+  //! Get the volumes of local mesh elements. The values are computed once and
+  //! cached until the geometry is invalidated.
+  //! \return Volumes of local mesh elements
+  gsl::span<const double> local_volumes() const;
+
   double pressure_bc_; //! System pressure in [MPa]
 
   //! The displacements of local elements, relative to rank 0. Used in an MPI
@@ -70,21 +118,38 @@ public:
 
 protected:
   //! Initialize the counts and displacements of local elements for each MPI Rank.
+  //! Since the local elements may have changed, this also invalidates the cached
+  //! geometry.
   void init_displs();
 
+  //! Discard the cached centroids, volumes, and fluid mask of the local elements.
+  //! init_displs() calls this when the elements are partitioned. No driver moves its
+  //! mesh yet; one that does must call this after each mesh update.
+  void invalidate_geometry();
+
 private:
   //! Gather local distributed field into global field (on rank 0)
   //! \return Global field collected from all ranks
   template<typename T>
-  std::vector<T> gather(const std::vector<T>& local_field) const;
+  std::vector<T> gather(gsl::span<const T> local_field) const;
+
+  //! Gather local distributed field into a caller-provided global field (on rank 0)
+  //! \param local_field Field values of local elements
+  //! \param[out] global_field Global field collected from all ranks
+  template<typename T>
+  void gather(gsl::span<const T> local_field, gsl::span<T> global_field) const;
 
   //! Get temperature of local mesh elements
-  //! \return Temperature of local mesh elements in [K]
-  virtual std::vector<double> temperature_local() const = 0;
+  //! \param[out] local Temperature of local mesh elements in [K]
+  virtual void temperature_local(gsl::span<double> local) const = 0;
 
   //! Get density of local mesh elements
-  //! \return Density of local mesh elements in [g/cm^3]
-  virtual std::vector<double> density_local() const = 0;
+  //! \param[out] local Density of local mesh elements in [g/cm^3]
+  virtual void density_local(gsl::span<double> local) const = 0;
+
+  //! Get temperature and density of local mesh elements
+  //! \param[out] local Fields of local mesh elements
+  virtual void fields_local(gsl::span<ElementFields> local) const = 0;
 
   //! States whether each local region is in fluid
   //! \return For each local region, 1 if region is in fluid and 0 otherwise
@@ -97,16 +162,46 @@ private:
   //! Get volumes of local mesh elements
   //! \return Volumes of local mesh elements
   virtual std::vector<double> volume_local() const = 0;
+
+  //! Buffer for local element fields, sized once by init_displs() so that
+  //! gathering fields during Picard iterations does not allocate memory
+  std::vector<double> local_buffer_;
+
+  //! Buffer for the fields of local elements, sized once by init_displs()
+  std::vector<ElementFields> local_fields_;
+
+  //! Compute the centroids, volumes, and fluid mask of the local elements if they
+  //! are not cached
+  void cache_geometry() const;
+
+  //! Whether the geometry of the local elements is cached
+  mutable bool geometry_cached_{false};
+
+  mutable std::vector<Position> local_centroids_; //!< Cached local centroids
+  mutable std::vector<double> local_volumes_;     //!< Cached local volumes
+  mutable std::vector<int> local_fluid_mask_;     //!< Cached local fluid mask
 };
 
 template<typename T>
-std::vector<T> HeatFluidsDriver::gather(const std::vector<T>& local_field) const
+std::vector<T> HeatFluidsDriver::gather(gsl::span<const T> local_field) const
 {
   std::vector<T> global_field;
 
+  if (this->active() && this->has_coupling_data()) {
+    global_field.resize(this->n_global_elem());
+  }
+  this->gather(local_field, gsl::span<T>(global_field));
+
+  return global_field;
+}
+
+template<typename T>
+void HeatFluidsDriver::gather(gsl::span<const T> local_field,
+                              gsl::span<T> global_field) const
+{
   if (this->active()) {
     if (this->has_coupling_data()) {
-      global_field.resize(this->n_global_elem());
+      Expects(global_field.size() == this->n_global_elem());
     }
 
     // Gather all the local quantities on to the root process
@@ -118,8 +213,6 @@ std::vector<T> HeatFluidsDriver::gather(const std::vector<T>& local_field) const
                   local_displs_.data(),
                   get_mpi_type<T>());
   }
-
-  return global_field;
 }
 
 } // namespace enrico
@@ -0,0 +1,85 @@
+//! \file memory.h
+//! Accounting of the memory used by processes and data structures
+#ifndef ENRICO_MEMORY_H
+#define ENRICO_MEMORY_H
+
+#include "enrico/comm.h"
+
+#include <xtensor/xtensor.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace enrico {
+
+//! Memory used by the calling process
+struct MemoryUsage {
+  double rss{0.0}; //!< Resident set size in [MiB]
+  double hwm{0.0}; //!< High-water mark of the resident set size in [MiB]
+};
+
+//! Get the memory used by the calling process
+//! \return Current and peak resident set size, or zeros if they cannot be read
+MemoryUsage memory_usage();
+
+//! Display the memory used by the ranks of a communicator
+//!
+//! The resident set size and its high-water mark are reduced over comm, and their
+//! maximum and total are displayed by the root of comm. Must be called by all ranks of
+//! comm; does nothing on ranks where comm is not active.
+//!
+//! \param comm Communicator whose ranks are reported
+//! \param label Description of the ranks and the point in the run
+void report_memory(const Comm& comm, const std::string& label);
+
+//! Display the bytes held by a data structure on the ranks of a communicator
+//!
+//! The maximum and total over the ranks of comm are displayed by the root of comm.
+//! Must be called by all ranks of comm; does nothing on ranks where comm is not active.
+//!
+//! \param comm Communicator whose ranks are reported
+//! \param name Name of the data structure
+//! \param bytes Bytes held by the data structure on the calling rank
+void report_bytes(const Comm& comm, const std::string& name, std::size_t bytes);
+
+//! Get the bytes held by the elements of a vector, including unused capacity
+template<typename T>
+std::size_t memory_bytes(const std::vector<T>& values)
+{
+  return values.capacity() * sizeof(T);
+}
+
+//! Get the bytes held by a vector of vectors, including unused capacity
+template<typename T>
+std::size_t memory_bytes(const std::vector<std::vector<T>>& values)
+{
+  std::size_t bytes = values.capacity() * sizeof(std::vector<T>);
+  for (const auto& v : values) {
+    bytes += memory_bytes(v);
+  }
+  return bytes;
+}
+
+//! Get the bytes held by the elements of an xtensor
+template<typename T, std::size_t N>
+std::size_t memory_bytes(const xt::xtensor<T, N>& values)
+{
+  return values.size() * sizeof(T);
+}
+
+//! Get the bytes held by the elements of a deque of xtensors
+template<typename T, std::size_t N>
+std::size_t memory_bytes(const std::deque<xt::xtensor<T, N>>& values)
+{
+  std::size_t bytes = 0;
+  for (const auto& v : values) {
+    bytes += memory_bytes(v);
+  }
+  return bytes;
+}
+
+} // namespace enrico
+
+#endif // ENRICO_MEMORY_H
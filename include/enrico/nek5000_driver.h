@@ -107,12 +107,16 @@ public:
   // std::vector<int> local_ordering_;
 private:
   //! Get temperature of local mesh elements
-  //! \return Temperature of local mesh elements in [K]
-  std::vector<double> temperature_local() const override;
+  //! \param[out] local Temperature of local mesh elements in [K]
+  void temperature_local(gsl::span<double> local) const override;
 
   //! Get density of local mesh elements
-  //! \return Density of local mesh elements in [g/cm^3]
-  std::vector<double> density_local() const override;
+  //! \param[out] local Density of local mesh elements in [g/cm^3]
+  void density_local(gsl::span<double> local) const override;
+
+  //! Get temperature and density of local mesh elements
+  //! \param[out] local Fields of local mesh elements
+  void fields_local(gsl::span<ElementFields> local) const override;
 
   //! States whether each local region is in fluid
   //! \return For each local region, 1 if region is in fluid and 0 otherwise
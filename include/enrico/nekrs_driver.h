@@ -16,6 +16,17 @@ public:
   void solve_step() override;
   void write_step(int timestep, int iteration) override;
 
+  //! Advance each following solve_step() from the current state by one coupled
+  //! timestep instead of integrating over the time window of the .par file
+  //! \param time Time at the start of the timestep in [s], relative to the NekRS
+  //!        start time
+  //! \param dt Length of the timestep in [s]; must be a multiple of the NekRS dt
+  void set_timestep(double time, double dt) override;
+
+  //! The solution fields cannot be written back through the NekRS interface, so a
+  //! coupled timestep cannot be repeated
+  bool can_repeat_timestep() const override { return false; }
+
   int n_local_elem() const override { return n_local_elem_; }
   std::size_t n_global_elem() const override { return n_global_elem_; };
 
@@ -31,8 +42,9 @@ public:
 private:
   std::vector<Position> centroid_local() const override;
   std::vector<double> volume_local() const override;
-  std::vector<double> temperature_local() const override;
-  std::vector<double> density_local() const override;
+  void temperature_local(gsl::span<double> local) const override;
+  void density_local(gsl::span<double> local) const override;
+  void fields_local(gsl::span<ElementFields> local) const override;
   std::vector<int> fluid_mask_local() const override;
 
   void open_lib_udf();
@@ -41,8 +53,10 @@ private:
   std::string setup_file_;
   std::string thread_model_;
   std::string device_number_;
-  double time_;
-  int tstep_;
+  double time_{0.0};
+  int tstep_{1};
+  bool continuous_time_{false}; //!< Whether the clock advances across solve steps
+  double step_end_;             //!< Time at the end of the coupled timestep in [s]
   int n_local_elem_;
   std::size_t n_global_elem_;
   int poly_deg_;
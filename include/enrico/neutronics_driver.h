@@ -8,13 +8,17 @@
 #include "enrico/mpi_types.h"
 
 #include <gsl/gsl>
+#include <xtensor/xbuilder.hpp>
 #include <xtensor/xtensor.hpp>
 
+#include <cstdint>
 #include <vector>
 
 namespace enrico {
 
-using CellHandle = gsl::index;
+//! Index of a neutronics cell instance. Handles are stored for every TH element and
+//! broadcast to all ranks, so they are kept at 32 bits.
+using CellHandle = int32_t;
 
 //! Base class for driver that controls a neutronics solve
 class NeutronicsDriver : public Driver {
@@ -30,11 +34,50 @@ public:
   //! \return Heat source in each material as [W/cm3]
   virtual xt::xtensor<double, 1> heat_source(double power) const = 0;
 
+  //! Get energy deposition in each material normalized to a given power, reusing the
+  //! memory of a caller-provided tensor. The default implementation allocates;
+  //! drivers override it to compute the heat source in place.
+  //! \param power User-specified power in [W]
+  //! \param[out] heat Heat source in each material as [W/cm3]
+  virtual void heat_source(double power, xt::xtensor<double, 1>& heat) const
+  {
+    heat = this->heat_source(power);
+  }
+
+  //! Get the standard deviation of the heat source in each material normalized to a
+  //! given power. Drivers without statistical uncertainty return zeros.
+  //! \param power User-specified power in [W]
+  //! \return Standard deviation of the heat source in each material as [W/cm3]
+  virtual xt::xtensor<double, 1> heat_source_std_dev(double power) const
+  {
+    return xt::zeros<double>({this->n_cells()});
+  }
+
+  //! Get the standard deviation of the heat source in each material normalized to a
+  //! given power, reusing the memory of a caller-provided tensor
+  //! \param power User-specified power in [W]
+  //! \param[out] std_dev Standard deviation of the heat source in each material as
+  //!             [W/cm3]
+  virtual void heat_source_std_dev(double power, xt::xtensor<double, 1>& std_dev) const
+  {
+    std_dev = this->heat_source_std_dev(power);
+  }
+
+  //! Get the number of realizations accumulated in the heat source tallies. This is
+  //! used to weight heat sources from independent replicas of the driver.
+  //! \return Number of realizations
+  virtual int n_realizations() const { return 1; }
+
   //! Find cells corresponding to a vector of positions
   //! \param positions (x,y,z) coordinates to search for
   //! \return Handles to cells
   virtual std::vector<CellHandle> find(const std::vector<Position>& positions) = 0;
 
+  //! Renumber the cells found so far. This must be called before tallies are created.
+  //! \param order Current handles of the cells, in their new order; i.e., the cell
+  //!              with handle order[i] gets handle i
+  virtual void reorder_cells(const std::vector<CellHandle>& order) = 0;
+
   //! Set the density of the material in a cell
   //! \param cell Handle to a cell
   //! \param rho Density in [g/cm^3]
@@ -13,6 +13,7 @@
 #include <gsl/gsl>
 #include <mpi.h>
 
+#include <cstdint>
 #include <vector>
 
 namespace enrico {
@@ -35,6 +36,10 @@ public:
   //! \return Handles to cells
   std::vector<CellHandle> find(const std::vector<Position>& position) override;
 
+  //! Renumber the cells found so far
+  //! \param order Current handles of the cells, in their new order
+  void reorder_cells(const std::vector<CellHandle>& order) override;
+
   //! Set the density of the material in a cell
   //! \param cell Handle to a cell
   //! \param rho Density in [g/cm^3]
@@ -74,8 +79,43 @@ public:
   //! \return Number of cells
   xt::xtensor<double, 1> heat_source(double power) const final;
 
+  //! Get energy deposition in each material normalized to a given power, computed in
+  //! place in a caller-provided tensor
+  //! \param power User-specified power in [W]
+  //! \param[out] heat Heat source in each material as [W/cm3]
+  void heat_source(double power, xt::xtensor<double, 1>& heat) const final;
+
+  //! Get the standard deviation of the heat source in each material normalized to a
+  //! given power, based on the variance of the mean of the heat source tally
+  //! \param power User-specified power in [W]
+  //! \return Standard deviation of the heat source in each material as [W/cm3]
+  xt::xtensor<double, 1> heat_source_std_dev(double power) const final;
+
+  //! Get the standard deviation of the heat source in each material normalized to a
+  //! given power, computed in place in a caller-provided tensor
+  //! \param power User-specified power in [W]
+  //! \param[out] std_dev Standard deviation of the heat source in each material as
+  //!             [W/cm3]
+  void heat_source_std_dev(double power, xt::xtensor<double, 1>& std_dev) const final;
+
+  //! Get the number of realizations accumulated in the heat source tally
+  //! \return Number of realizations
+  int n_realizations() const final;
+
   std::string cell_label(CellHandle cell) const;
 
+  //! Get the seed of OpenMC's random number generator
+  //! \return Random number seed
+  int64_t seed() const;
+
+  //! Set the seed of OpenMC's random number generator
+  //! \param seed Random number seed
+  void set_seed(int64_t seed);
+
+  //! Stop OpenMC from writing its summary, statepoint, and tally output files, e.g.,
+  //! for a replica that shares a working directory with another replica
+  void disable_output();
+
   //////////////////////////////////////////////////////////////////////////////
   // Driver interface
 
@@ -93,12 +133,17 @@ public:
   //! Finalization required in each Picard iteration
   void finalize_step() final;
 
+  //! Get the bytes held by the cell instances and the results of the energy
+  //! deposition tally, which is owned by OpenMC
+  //! \return Number of bytes
+  std::size_t memory_bytes() const final;
+
 private:
   // Data members
-  openmc::Tally* tally_;               //!< Fission energy deposition tally
-  openmc::CellInstanceFilter* filter_; //!< Cell instance filter
-  std::vector<CellInstance> cells_;    //!< Array of cell instances
-  int n_fissionable_cells_;            //!< Number of fissionable cells in model
+  openmc::Tally* tally_{nullptr};               //!< Fission energy deposition tally
+  openmc::CellInstanceFilter* filter_{nullptr}; //!< Cell instance filter
+  std::vector<CellInstance> cells_;             //!< Array of cell instances
+  int n_fissionable_cells_;                     //!< Number of fissionable cells in model
 };
 
 } // namespace enrico
@@ -0,0 +1,50 @@
+//! \file predictor.h
+//! Extrapolation of coupled fields to the start of a new timestep
+#ifndef ENRICO_PREDICTOR_H
+#define ENRICO_PREDICTOR_H
+
+#include <xtensor/xtensor.hpp>
+
+#include <deque>
+#include <vector>
+
+namespace enrico {
+
+//! Get the order of extrapolation possible from the saved history
+//!
+//! The order is reduced during the first timesteps, since an extrapolating polynomial
+//! of order n needs the values of n + 1 previous timesteps.
+//!
+//! \param max_order Requested order of the extrapolating polynomial
+//! \param times Times of the previous values; must not be empty
+//! \return Order of the extrapolating polynomial
+int extrapolation_order(int max_order, const std::deque<double>& times);
+
+//! Compute the weights of Lagrange extrapolation from previous times
+//!
+//! The times need not be equally spaced, so the weights also apply to adaptive
+//! timesteps. For equally spaced times, they are {2, -1} for linear and {3, -3, 1}
+//! for quadratic extrapolation.
+//!
+//! \param times Distinct times of the previous values, most recent first
+//! \param order Order of the extrapolating polynomial (at most times.size() - 1)
+//! \param t Time to extrapolate to
+//! \return Weight of each of the order + 1 most recent values
+std::vector<double>
+extrapolation_weights(const std::deque<double>& times, int order, double t);
+
+//! Extrapolate a field from its values at previous timesteps
+//!
+//! Where the extrapolated value is not positive, which is non-physical for
+//! temperatures, densities, and heat sources, the most recent value is used instead.
+//!
+//! \param history Values at previous timesteps, most recent first
+//! \param weights Weights from extrapolation_weights(), one per value used
+//! \param field Extrapolated field
+void extrapolate(const std::deque<xt::xtensor<double, 1>>& history,
+                 const std::vector<double>& weights,
+                 xt::xtensor<double, 1>& field);
+
+} // namespace enrico
+
+#endif // ENRICO_PREDICTOR_H
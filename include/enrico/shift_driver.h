@@ -31,12 +31,17 @@ public:
 
   // get the heat source normalized to the given total power
   xt::xtensor<double, 1> heat_source(double power) const final;
+  using NeutronicsDriver::heat_source;
 
   //! Find cells corresponding to a vector of positions
   //! \param positions (x,y,z) coordinates to search for
   //! \return Handles to cells
   std::vector<CellHandle> find(const std::vector<Position>& positions) override;
 
+  //! Renumber the cells found so far
+  //! \param order Current handles of the cells, in their new order
+  void reorder_cells(const std::vector<CellHandle>& order) override;
+
   //! Set the density of the material in a cell
   //! \param cell Handle to a cell
   //! \param rho Density in [g/cm^3]
@@ -0,0 +1,44 @@
+//! \file space_filling_curve.h
+//! Ordering of points along space-filling curves
+#ifndef ENRICO_SPACE_FILLING_CURVE_H
+#define ENRICO_SPACE_FILLING_CURVE_H
+
+#include "enrico/geom.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace enrico {
+
+//! Orderings of the cells used for coupling. 'find' keeps the order in which the
+//! neutronics driver first found each cell, while 'morton' and 'hilbert' sort the
+//! cells along a space-filling curve through their centroids.
+enum class CellOrder { find, morton, hilbert };
+
+//! Number of bits per coordinate in the keys of a space-filling curve
+constexpr int CURVE_BITS = 21;
+
+//! Compute the key of a point on the Morton (Z-order) curve
+//! \param x Quantized x-coordinate, less than 2^CURVE_BITS
+//! \param y Quantized y-coordinate, less than 2^CURVE_BITS
+//! \param z Quantized z-coordinate, less than 2^CURVE_BITS
+//! \return Key with the bits of the coordinates interleaved
+std::uint64_t morton_key(std::uint32_t x, std::uint32_t y, std::uint32_t z);
+
+//! Compute the key of a point on the Hilbert curve
+//! \param x Quantized x-coordinate, less than 2^CURVE_BITS
+//! \param y Quantized y-coordinate, less than 2^CURVE_BITS
+//! \param z Quantized z-coordinate, less than 2^CURVE_BITS
+//! \return Distance of the point along the curve
+std::uint64_t hilbert_key(std::uint32_t x, std::uint32_t y, std::uint32_t z);
+
+//! Order points along a space-filling curve through their bounding box
+//! \param points Points to order
+//! \param order Curve to order the points along; must not be CellOrder::find
+//! \return Indices of the points in order along the curve. Points with the same key
+//!         keep their relative order.
+std::vector<int32_t> curve_order(const std::vector<Position>& points, CellOrder order);
+
+} // namespace enrico
+
+#endif // ENRICO_SPACE_FILLING_CURVE_H
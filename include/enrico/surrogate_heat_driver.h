@@ -142,7 +142,10 @@ private:
  * linked to the fluid phase by conjugate heat transfer, which is treated
  * here with a pseudo-steady-state approach where the power entering the fluid
  * matches the power in the rod at that axial elevation. It is assumed that
- * there is zero thermal resistance between the rod and the fluid.
+ * there is zero thermal resistance between the rod and the fluid. When the
+ * coupled driver sets a timestep, the solid conduction becomes transient and
+ * each solve advances the rod temperatures over the timestep, while the fluid
+ * remains pseudo-steady.
  *
  * The fluid solution is obtained with a very simplified "subchannel" method
  * that neglects all crossflow terms between channels such that the method
@@ -182,6 +185,18 @@ public:
   //! Solves the heat-fluids surrogate solver
   void solve_step() final;
 
+  //! Switch the solid conduction to transient mode with the given timestep, or
+  //! back to steady state if the timestep is zero
+  //! \param time Time at the start of the timestep in [s]
+  //! \param dt Length of the timestep in [s]
+  void set_timestep(double time, double dt) override;
+
+  //! Save the solid temperature at the start of a coupled timestep
+  void save_state() override;
+
+  //! Restore the solid temperature saved by save_state()
+  void restore_state() override;
+
   void solve_heat();
 
   void solve_fluid();
@@ -231,9 +246,20 @@ public:
   //! Returns convergence tolerance for solid energy equation
   double heat_tol() const { return heat_tol_; }
 
+  //! Returns timestep of the transient solid conduction in [s], or zero for steady
+  //! state
+  double timestep() const { return dt_; }
+
   //! Write data to VTK
   void write_step(int timestep, int iteration) final;
 
+  //! Find the element containing a given position
+  //! \param r Position in [cm]
+  //! \return Index of the element containing the position, using the same ordering of
+  //!         solid and fluid elements as the coupling fields, or -1 if the position is
+  //!         outside the bundle or in the pellet-clad gap
+  int32_t element_at(const Position& r) const;
+
   //! Returns solid temperature in [K] for given region
   double solid_temperature(std::size_t pin, std::size_t axial, std::size_t ring) const;
 
@@ -289,12 +315,16 @@ public:
 
 private:
   //! Get temperature of local mesh elements
-  //! \return Temperature of local mesh elements in [K]
-  std::vector<double> temperature_local() const override;
+  //! \param[out] local Temperature of local mesh elements in [K]
+  void temperature_local(gsl::span<double> local) const override;
 
   //! Get density of local mesh elements
-  //! \return Density of local mesh elements in [g/cm^3]
-  std::vector<double> density_local() const override;
+  //! \param[out] local Density of local mesh elements in [g/cm^3]
+  void density_local(gsl::span<double> local) const override;
+
+  //! Get temperature and density of local mesh elements
+  //! \param[out] local Fields of local mesh elements
+  void fields_local(gsl::span<ElementFields> local) const override;
 
   //! States whether each local region is in fluid
   //! \return For each local region, 1 if region is in fluid and 0 otherwise
@@ -343,6 +373,9 @@ private:
   //!< solid temperature in [K] for each (pin, axial segment, ring)
   xt::xtensor<double, 3> solid_temperature_;
 
+  //! Solid temperature in [K] at the start of the current coupled timestep
+  xt::xtensor<double, 3> saved_solid_temperature_;
+
   //! Flow areas for coolant-centered channels
   xt::xtensor<double, 1> channel_areas_;
 
@@ -386,6 +419,9 @@ private:
   //! of 1e-4
   double heat_tol_ = 1e-4;
 
+  //! Timestep of the transient solid conduction in [s]; zero for steady state
+  double dt_ = 0.0;
+
   //! Gravitational acceleration
   const double g_ = 9.81;
 
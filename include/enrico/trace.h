@@ -0,0 +1,108 @@
+//! \file trace.h
+//! Per-rank timeline tracing in the Chrome trace event format
+#ifndef ENRICO_TRACE_H
+#define ENRICO_TRACE_H
+
+#include <mpi.h>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+namespace enrico {
+
+namespace detail {
+//! Whether events are being recorded
+extern std::atomic<bool> trace_enabled;
+} // namespace detail
+
+//! Whether events are being recorded. This is a single relaxed load, so it is
+//! inexpensive enough to check in every traced scope.
+inline bool tracing()
+{
+  return detail::trace_enabled.load(std::memory_order_relaxed);
+}
+
+//! Start recording events on the calling rank
+//!
+//! Each thread records into its own ring buffer, so that the oldest events are
+//! overwritten once a buffer is full. Times are measured from this call, so it should
+//! be made right after a barrier to align the timelines of different ranks.
+//!
+//! \param capacity Number of events held by the buffer of each thread
+void start_tracing(std::size_t capacity);
+
+//! Stop recording events and write the events of all ranks to a file
+//!
+//! Each rank writes its events at its own offset of a Chrome trace JSON file with
+//! MPI-IO, so no rank holds the events of other ranks. The file can be viewed in
+//! Perfetto (ui.perfetto.dev) or chrome://tracing. Each rank is shown as a process
+//! and each thread as a thread. Must be called by all ranks of comm; does nothing if
+//! tracing was not started.
+//!
+//! \param comm Communicator containing all traced ranks
+//! \param filename Path of the file to write
+void write_trace(MPI_Comm comm, const std::string& filename);
+
+//! Get the time since tracing started
+//! \return Time in [us]
+double trace_time();
+
+//! Record a complete event on the calling thread
+//! \param name Name of the event, which must outlive the trace (e.g., a literal)
+//! \param start Start time of the event in [us]
+//! \param bytes Number of bytes communicated during the event, or -1 if not applicable
+void trace_event(const char* name, double start, long bytes);
+
+//! Records an event spanning the lifetime of the object
+class TraceScope {
+public:
+  //! Start an event
+  //! \param name Name of the event, which must outlive the trace (e.g., a literal)
+  //! \param bytes Number of bytes communicated during the event, or -1 if not
+  //!        applicable
+  explicit TraceScope(const char* name, long bytes = -1)
+    : name_(name)
+    , bytes_(bytes)
+    , active_(tracing())
+  {
+    if (active_) {
+      start_ = trace_time();
+    }
+  }
+
+  //! Start an event that communicates a buffer of MPI datatypes
+  //! \param name Name of the event, which must outlive the trace (e.g., a literal)
+  //! \param count Number of elements in the buffer
+  //! \param datatype Data type of the buffer elements
+  TraceScope(const char* name, int count, MPI_Datatype datatype)
+    : TraceScope(name)
+  {
+    if (active_) {
+      int size;
+      MPI_Type_size(datatype, &size);
+      bytes_ = static_cast<long>(count) * size;
+    }
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+  //! End the event
+  ~TraceScope()
+  {
+    if (active_) {
+      trace_event(name_, start_, bytes_);
+    }
+  }
+
+private:
+  const char* name_;  //!< Name of the event
+  long bytes_;        //!< Bytes communicated during the event
+  bool active_;       //!< Whether tracing was on when the event started
+  double start_{0.0}; //!< Start time of the event in [us]
+};
+
+} // namespace enrico
+
+#endif // ENRICO_TRACE_H
@@ -0,0 +1,145 @@
+#include "enrico/affinity.h"
+
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace enrico {
+
+namespace {
+
+//! Directory in sysfs describing a given CPU
+std::string cpu_sysfs_dir(int cpu)
+{
+  return "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+}
+
+//! NUMA domain of a CPU, found from the nodeN link in its sysfs directory
+int cpu_numa_node(int cpu)
+{
+  int node = -1;
+#ifdef __linux__
+  DIR* dir = opendir(cpu_sysfs_dir(cpu).c_str());
+  if (!dir) {
+    return node;
+  }
+  while (dirent* entry = readdir(dir)) {
+    std::string name{entry->d_name};
+    if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+        name.find_first_not_of("0123456789", 4) == std::string::npos) {
+      node = std::stoi(name.substr(4));
+      break;
+    }
+  }
+  closedir(dir);
+#endif
+  return node;
+}
+
+//! Socket of a CPU, as reported by its physical package id
+int cpu_socket(int cpu)
+{
+  int socket = -1;
+  std::ifstream f{cpu_sysfs_dir(cpu) + "/topology/physical_package_id"};
+  if (f) {
+    f >> socket;
+  }
+  return f ? socket : -1;
+}
+
+} // namespace
+
+std::vector<int> affinity_cpus()
+{
+  std::vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  return cpus;
+}
+
+int affinity_domain(Placement placement)
+{
+  if (placement == Placement::rank) {
+    return 0;
+  }
+  auto cpus = affinity_cpus();
+  if (cpus.empty()) {
+    return 0;
+  }
+
+  int domain = placement == Placement::numa ? cpu_numa_node(cpus.front())
+                                            : cpu_socket(cpus.front());
+  return domain >= 0 ? domain : 0;
+}
+
+std::string cpu_list_string(const std::vector<int>& cpus)
+{
+  if (cpus.empty()) {
+    return "-";
+  }
+
+  std::string s;
+  std::size_t i = 0;
+  while (i < cpus.size()) {
+    // Extend the range as long as the CPUs are consecutive
+    std::size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+      ++j;
+    }
+    if (!s.empty()) {
+      s += ',';
+    }
+    s += std::to_string(cpus[i]);
+    if (j > i) {
+      s += '-' + std::to_string(cpus[j]);
+    }
+    i = j + 1;
+  }
+  return s;
+}
+
+void set_num_threads(int n_threads)
+{
+#ifdef _OPENMP
+  omp_set_num_threads(n_threads);
+#endif
+}
+
+void bind_threads()
+{
+#if defined(_OPENMP) && defined(__linux__)
+  auto cpus = affinity_cpus();
+  if (cpus.empty()) {
+    return;
+  }
+
+#pragma omp parallel
+  {
+    // With pid 0, sched_setaffinity applies to the calling thread only
+    int cpu = cpus[omp_get_thread_num() % cpus.size()];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+  }
+#endif
+}
+
+} // namespace enrico
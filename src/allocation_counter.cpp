@@ -0,0 +1,46 @@
+#include "enrico/allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+//! Number of heap allocations made by this process
+std::atomic<std::size_t> n_allocations{0};
+
+} // namespace
+
+#ifdef ENRICO_COUNT_ALLOCATIONS
+
+// Replacements of the global allocation functions that count each allocation. The
+// array and nothrow forms of operator new and delete forward to these by default.
+void* operator new(std::size_t size)
+{
+  n_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+#endif
+
+namespace enrico {
+
+std::size_t allocation_count()
+{
+  return n_allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace enrico
@@ -14,7 +14,18 @@ CellInstance::CellInstance(Position position)
   // Get cell index/instance corresponding to position
   double xyz[3] = {position.x, position.y, position.z};
   err_chk(openmc_find_cell(xyz, &index_, &instance_));
+  init_material();
+}
 
+CellInstance::CellInstance(int32_t index, int32_t instance)
+  : index_{index}
+  , instance_{instance}
+{
+  init_material();
+}
+
+void CellInstance::init_material()
+{
   // Determine what material fills the cell instance
   int type;
   int32_t* indices;
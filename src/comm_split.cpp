@@ -1,10 +1,51 @@
 #include "enrico/comm_split.h"
 
+#include <algorithm>
+#include <climits> // for INT_MAX
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 namespace enrico {
 
+namespace {
+
+//! Order the ranks on a node so that consecutive ranks alternate between domains
+//!
+//! \param domains Domain (NUMA node or socket) of each node-local rank
+//! \param rank Node-local rank to find the position of
+//! \return Position of rank in an ordering that takes the first rank of each domain,
+//!         then the second rank of each domain, and so on
+int spread_index(const std::vector<int>& domains, int rank)
+{
+  int n = domains.size();
+
+  // Ordinal of each rank among the ranks in the same domain
+  std::vector<int> ordinal(n);
+  for (int i = 0; i < n; ++i) {
+    ordinal[i] = std::count(domains.begin(), domains.begin() + i, domains[i]);
+  }
+
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    if (ordinal[a] != ordinal[b])
+      return ordinal[a] < ordinal[b];
+    if (domains[a] != domains[b])
+      return domains[a] < domains[b];
+    return a < b;
+  });
+
+  return std::find(order.begin(), order.end(), rank) - order.begin();
+}
+
+} // namespace
+
 void get_driver_comms(Comm super_comm,
                       std::array<int, 2> num_nodes,
                       std::array<int, 2> procs_per_node,
+                      Placement placement,
                       std::array<Comm, 2>& driver_comms,
                       Comm& intranode_comm,
                       Comm& coupling_comm)
@@ -34,6 +75,16 @@ void get_driver_comms(Comm super_comm,
   int node_idx = coupling_comm.rank;
   intranode_comm.broadcast(node_idx);
 
+  // Position of each rank on its node, used to choose the procs_per_node ranks. When
+  // spreading over domains, the first positions cycle through the domains.
+  int local_idx = intranode_comm.rank;
+  if (placement != Placement::rank) {
+    int domain = affinity_domain(placement);
+    std::vector<int> domains(intranode_comm.size);
+    intranode_comm.Allgather(&domain, 1, MPI_INT, domains.data(), 1, MPI_INT);
+    local_idx = spread_index(domains, intranode_comm.rank);
+  }
+
   // Get the driver comms. driver_comms[0] gets the left-hand nodes, and
   // driver_comms[1] gets the right-hand nodes, both based on the node_idx
   for (const int i : {0, 1}) {
@@ -47,11 +98,11 @@ void get_driver_comms(Comm super_comm,
     int color;
     // Left-hand nodes
     if (i == 0) {
-      color = (node_idx < n && intranode_comm.rank < ppn) ? KEEP : DISCARD;
+      color = (node_idx < n && local_idx < ppn) ? KEEP : DISCARD;
     }
     // Right-hand nodes
     else {
-      color = (node_idx >= total_nodes - n && intranode_comm.rank < ppn) ? KEEP : DISCARD;
+      color = (node_idx >= total_nodes - n && local_idx < ppn) ? KEEP : DISCARD;
     }
     MPI_Comm_split(super_comm.comm, color, super_comm.rank, &temp_comm);
     scomm = Comm(temp_comm);
@@ -61,4 +112,101 @@ void get_driver_comms(Comm super_comm,
   }
 }
 
+void get_mpmd_comms(Comm super_comm,
+                    std::array<Comm, 2>& driver_comms,
+                    Comm& intranode_comm,
+                    Comm& coupled_comm)
+{
+  MPI_Comm temp_comm;
+
+  // The application number is the position of the executable on the mpirun command line
+  int* appnum;
+  int flag;
+  MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_APPNUM, &appnum, &flag);
+  int app = flag ? *appnum : 0;
+  int max_app;
+  MPI_Allreduce(&app, &max_app, 1, MPI_INT, MPI_MAX, super_comm.comm);
+  if (!flag || max_app != 1) {
+    throw std::runtime_error{"MPMD communication requires that exactly two "
+                             "executables be launched, neutronics first"};
+  }
+
+  MPI_Comm_split_type(
+    super_comm.comm, MPI_COMM_TYPE_SHARED, super_comm.rank, MPI_INFO_NULL, &temp_comm);
+  intranode_comm = Comm(temp_comm);
+
+  // Ranks of the same executable form the local comm of the intercommunicator
+  MPI_Comm local_comm;
+  MPI_Comm_split(super_comm.comm, app, super_comm.rank, &local_comm);
+
+  // The remote leader is the lowest rank in super_comm of the other executable
+  std::array<int, 2> leaders{INT_MAX, INT_MAX};
+  leaders[app] = super_comm.rank;
+  MPI_Allreduce(MPI_IN_PLACE, leaders.data(), 2, MPI_INT, MPI_MIN, super_comm.comm);
+
+  const int tag = 0;
+  MPI_Comm intercomm;
+  MPI_Intercomm_create(local_comm, 0, super_comm.comm, leaders[1 - app], tag, &intercomm);
+
+  // Merging with high = app orders the neutronics ranks first
+  MPI_Intercomm_merge(intercomm, app, &temp_comm);
+  coupled_comm = Comm(temp_comm);
+  MPI_Comm_free(&intercomm);
+
+  driver_comms[app] = Comm(local_comm);
+  driver_comms[1 - app] = Comm();
+}
+
+int threads_per_rank(const Comm& driver_comm, const Comm& intranode_comm)
+{
+  int in_driver = driver_comm.active() ? 1 : 0;
+  int n_driver_ranks;
+  MPI_Allreduce(&in_driver, &n_driver_ranks, 1, MPI_INT, MPI_SUM, intranode_comm.comm);
+
+  if (!in_driver) {
+    return 0;
+  }
+  return std::max(1, intranode_comm.size / n_driver_ranks);
+}
+
+void get_replica_comms(Comm driver_comm,
+                       int n_replicas,
+                       Comm& replica_comm,
+                       Comm& replica_roots_comm,
+                       int& replica_idx)
+{
+  const int KEEP = 0;
+  const int DISCARD = 1;
+  MPI_Comm temp_comm;
+
+  replica_comm = Comm();
+  replica_roots_comm = Comm();
+  replica_idx = -1;
+
+  if (!driver_comm.active()) {
+    return;
+  }
+
+  if (n_replicas > driver_comm.size) {
+    throw std::runtime_error{"Number of replicas (" + std::to_string(n_replicas) +
+                             ") exceeds number of ranks in driver communicator (" +
+                             std::to_string(driver_comm.size) + ")"};
+  }
+
+  // Each replica gets a contiguous block of ranks from the driver comm
+  replica_idx = static_cast<int>(static_cast<long>(driver_comm.rank) * n_replicas /
+                                 driver_comm.size);
+  MPI_Comm_split(driver_comm.comm, replica_idx, driver_comm.rank, &temp_comm);
+  replica_comm = Comm(temp_comm);
+
+  // The replica roots comm consists of the root process of each replica, ordered by
+  // replica index
+  int color = replica_comm.is_root() ? KEEP : DISCARD;
+  MPI_Comm_split(driver_comm.comm, color, driver_comm.rank, &temp_comm);
+  replica_roots_comm = Comm(temp_comm);
+  if (color == DISCARD) {
+    replica_roots_comm.free();
+  }
+}
+
 }
@@ -0,0 +1,99 @@
+#include "enrico/compact_field.h"
+
+#include <algorithm> // for copy, fill, max, min
+#include <cmath>     // for abs, lround
+#include <limits>    // for numeric_limits
+
+namespace enrico {
+
+CompactField::CompactField(Precision precision, int n_components)
+  : precision_(precision)
+  , n_components_(n_components)
+  , offset_(n_components)
+  , scale_(n_components)
+  , error_(n_components)
+{
+  Expects(precision != Precision::full);
+  Expects(n_components > 0);
+}
+
+void CompactField::encode(gsl::span<const double> values)
+{
+  Expects(values.size() % n_components_ == 0);
+  std::fill(error_.begin(), error_.end(), 0.0);
+
+  if (precision_ == Precision::single) {
+    single_.resize(values.size());
+    for (gsl::index i = 0; i < values.size(); ++i) {
+      single_[i] = static_cast<float>(values[i]);
+      double& error = error_[i % n_components_];
+      error = std::max(error, std::abs(single_[i] - values[i]));
+    }
+    return;
+  }
+
+  // Map each component linearly from its range onto the 16-bit integers
+  constexpr double max_code = std::numeric_limits<uint16_t>::max();
+  for (int c = 0; c < n_components_; ++c) {
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -lo;
+    for (gsl::index i = c; i < values.size(); i += n_components_) {
+      lo = std::min(lo, values[i]);
+      hi = std::max(hi, values[i]);
+    }
+    offset_[c] = values.empty() ? 0.0 : lo;
+    scale_[c] = hi > lo ? (hi - lo) / max_code : 0.0;
+  }
+
+  fixed_.resize(values.size());
+  for (gsl::index i = 0; i < values.size(); ++i) {
+    int c = i % n_components_;
+    double x = scale_[c] > 0.0 ? (values[i] - offset_[c]) / scale_[c] : 0.0;
+    fixed_[i] = static_cast<uint16_t>(std::lround(x));
+    double decoded = offset_[c] + fixed_[i] * scale_[c];
+    error_[c] = std::max(error_[c], std::abs(decoded - values[i]));
+  }
+}
+
+void CompactField::decode(gsl::span<double> values) const
+{
+  Expects(values.size() == this->size());
+
+  if (precision_ == Precision::single) {
+    std::copy(single_.begin(), single_.end(), values.begin());
+  } else {
+    for (gsl::index i = 0; i < values.size(); ++i) {
+      int c = i % n_components_;
+      values[i] = offset_[c] + fixed_[i] * scale_[c];
+    }
+  }
+}
+
+void CompactField::send_and_recv(const Comm& comm, int dest, int source)
+{
+  if (precision_ == Precision::single) {
+    comm.send_and_recv(single_, dest, source);
+  } else {
+    comm.send_and_recv(offset_, dest, source);
+    comm.send_and_recv(scale_, dest, source);
+    comm.send_and_recv(fixed_, dest, source);
+  }
+}
+
+void CompactField::broadcast(const Comm& comm, int root)
+{
+  if (precision_ == Precision::single) {
+    comm.broadcast(single_, root);
+  } else {
+    comm.broadcast(offset_, root);
+    comm.broadcast(scale_, root);
+    comm.broadcast(fixed_, root);
+  }
+}
+
+std::size_t CompactField::size() const
+{
+  return precision_ == Precision::single ? single_.size() : fixed_.size();
+}
+
+} // namespace enrico
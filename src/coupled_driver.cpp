@@ -1,8 +1,12 @@
 #include "enrico/coupled_driver.h"
 
+#include "enrico/affinity.h"
+#include "enrico/allocation_counter.h"
 #include "enrico/comm_split.h"
 #include "enrico/driver.h"
 #include "enrico/error.h"
+#include "enrico/memory.h"
+#include "enrico/predictor.h"
 
 #ifdef USE_NEK5000
 #include "enrico/nek5000_driver.h"
@@ -17,15 +21,22 @@
 #include "enrico/shift_driver.h"
 #endif
 #include "enrico/surrogate_heat_driver.h"
+#include "enrico/trace.h"
 
 #include <gsl/gsl>
 #include <xtensor/xbuilder.hpp> // for empty
-#include <xtensor/xnorm.hpp>    // for norm_l1, norm_l2, norm_linf
+#include <xtensor/xnoalias.hpp>
+#include <xtensor/xnorm.hpp> // for norm_l1, norm_l2, norm_linf
 
-#include <algorithm> // for copy
+#include <algorithm> // for copy, fill, max
+#include <cmath>     // for abs, isinf, sqrt
+#include <cstdio>    // for snprintf
 #include <iomanip>
+#include <limits> // for numeric_limits
 #include <memory> // for make_unique
 #include <string>
+#include <unordered_set>
+#include <utility> // for move
 
 // For gethostname
 #ifdef _WIN32
@@ -51,6 +62,29 @@ CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
   // get optional coupling parameters, using defaults if not provided
   if (coup_node.child("epsilon"))
     epsilon_ = coup_node.child("epsilon").text().as_double();
+  if (coup_node.child("epsilon_rho"))
+    epsilon_rho_ = coup_node.child("epsilon_rho").text().as_double();
+  if (coup_node.child("epsilon_q"))
+    epsilon_q_ = coup_node.child("epsilon_q").text().as_double();
+  if (coup_node.child("heat_source_noise"))
+    heat_source_noise_ = coup_node.child("heat_source_noise").text().as_double();
+  if (coup_node.child("dt"))
+    dt_ = coup_node.child("dt").text().as_double();
+  if (coup_node.child("end_time")) {
+    end_time_ = coup_node.child("end_time").text().as_double();
+    if (!coup_node.child("max_timesteps")) {
+      max_timesteps_ = std::numeric_limits<int>::max();
+    }
+  }
+  if (coup_node.child("adaptive_dt")) {
+    auto node = coup_node.child("adaptive_dt");
+    adaptive_dt_ = true;
+    dt_min_ = node.attribute("min").as_double(dt_);
+    dt_max_ = node.attribute("max").as_double(dt_);
+    dt_grow_ = node.attribute("grow").as_double(dt_grow_);
+    dt_shrink_ = node.attribute("shrink").as_double(dt_shrink_);
+    dt_fast_iterations_ = node.attribute("fast_iterations").as_int(dt_fast_iterations_);
+  }
 
   // Determine relaxation parameters for heat source, temperature, and density
   auto set_alpha = [](pugi::xml_node node, double& alpha) {
@@ -58,6 +92,8 @@ CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
       std::string s = node.child_value();
       if (s == "robbins-monro") {
         alpha = ROBBINS_MONRO;
+      } else if (s == "aitken") {
+        alpha = AITKEN;
       } else {
         alpha = node.text().as_double();
         Expects(alpha > 0 && alpha <= 1.0);
@@ -67,6 +103,11 @@ CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
   set_alpha(coup_node.child("alpha"), alpha_);
   set_alpha(coup_node.child("alpha_T"), alpha_T_);
   set_alpha(coup_node.child("alpha_rho"), alpha_rho_);
+  if (coup_node.child("alpha_min"))
+    alpha_min_ = coup_node.child("alpha_min").text().as_double();
+  if (coup_node.child("alpha_max"))
+    alpha_max_ = coup_node.child("alpha_max").text().as_double();
+  Expects(alpha_min_ > 0 && alpha_min_ <= alpha_max_);
 
   // check for convergence norm
   if (coup_node.child("convergence_norm")) {
@@ -82,6 +123,92 @@ CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
     }
   }
 
+  if (coup_node.child("freeze_tolerance"))
+    freeze_tolerance_ = coup_node.child("freeze_tolerance").text().as_double();
+  if (coup_node.child("freeze_iterations"))
+    freeze_iterations_ = coup_node.child("freeze_iterations").text().as_int();
+  if (coup_node.child("freeze_refresh"))
+    freeze_refresh_ = coup_node.child("freeze_refresh").text().as_int();
+
+  if (coup_node.child("predictor_order")) {
+    predictor_order_ = coup_node.child("predictor_order").text().as_int();
+    if (predictor_order_ < 0 || predictor_order_ > 2) {
+      throw std::runtime_error{"Invalid value for <predictor_order>"};
+    }
+  }
+
+  if (coup_node.child("transfer_precision")) {
+    std::string s = coup_node.child_value("transfer_precision");
+    if (s == "double") {
+      transfer_precision_ = Precision::full;
+    } else if (s == "single") {
+      transfer_precision_ = Precision::single;
+    } else if (s == "fixed16") {
+      transfer_precision_ = Precision::fixed16;
+    } else {
+      throw std::runtime_error{"Invalid value for <transfer_precision>"};
+    }
+  }
+  if (transfer_precision_ != Precision::full) {
+    compact_fields_ = CompactField{transfer_precision_, 2};
+    compact_heat_source_ = CompactField{transfer_precision_, 1};
+  }
+
+  if (auto trace_node = coup_node.child("trace")) {
+    trace_file_ = trace_node.attribute("filename").as_string("trace.json");
+    if (trace_node.attribute("events")) {
+      trace_events_ = trace_node.attribute("events").as_ullong();
+    }
+  }
+
+  if (coup_node.child("field_history"))
+    history_file_ = coup_node.child_value("field_history");
+
+  if (coup_node.child("memory_report"))
+    memory_report_ = coup_node.child("memory_report").text().as_bool();
+
+  if (coup_node.child("communication")) {
+    std::string s = coup_node.child_value("communication");
+
+    if (s == "partitioned") {
+      communication_ = Communication::partitioned;
+    } else if (s == "overlapping") {
+      communication_ = Communication::overlapping;
+    } else if (s == "mpmd") {
+      communication_ = Communication::mpmd;
+    } else {
+      throw std::runtime_error{"Invalid value for <communication>"};
+    }
+  }
+
+  if (coup_node.child("placement")) {
+    std::string s = coup_node.child_value("placement");
+
+    if (s == "rank") {
+      placement_ = Placement::rank;
+    } else if (s == "numa") {
+      placement_ = Placement::numa;
+    } else if (s == "socket") {
+      placement_ = Placement::socket;
+    } else {
+      throw std::runtime_error{"Invalid value for <placement>"};
+    }
+  }
+
+  if (coup_node.child("cell_order")) {
+    std::string s = coup_node.child_value("cell_order");
+
+    if (s == "find") {
+      cell_order_ = CellOrder::find;
+    } else if (s == "morton") {
+      cell_order_ = CellOrder::morton;
+    } else if (s == "hilbert") {
+      cell_order_ = CellOrder::hilbert;
+    } else {
+      throw std::runtime_error{"Invalid value for <cell_order>"};
+    }
+  }
+
   if (coup_node.child("temperature_ic")) {
     std::string s = coup_node.child_value("temperature_ic");
 
@@ -106,31 +233,139 @@ CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
     }
   }
 
+  if (neut_node.child("replicas"))
+    n_replicas_ = neut_node.child("replicas").text().as_int();
+
+  if (heat_node.child("subcycles"))
+    heat_subcycles_ = heat_node.child("subcycles").text().as_int();
+  if (heat_node.child("subcycle_heat_source")) {
+    std::string s = heat_node.child_value("subcycle_heat_source");
+    if (s == "hold") {
+      interpolate_heat_source_ = false;
+    } else if (s == "interpolate") {
+      interpolate_heat_source_ = true;
+    } else {
+      throw std::runtime_error{"Invalid value for <subcycle_heat_source>"};
+    }
+  }
+
   Expects(power_ > 0);
   Expects(max_timesteps_ >= 0);
   Expects(max_picard_iter_ >= 0);
+  Expects(dt_ >= 0);
+  Expects(heat_subcycles_ > 0);
   Expects(epsilon_ > 0);
+  Expects(epsilon_rho_ > 0);
+  Expects(epsilon_q_ > 0);
+  Expects(heat_source_noise_ >= 0);
+  Expects(freeze_tolerance_ >= 0);
+  Expects(freeze_iterations_ > 0);
+  Expects(freeze_refresh_ > 0);
+  Expects(n_replicas_ > 0);
+  Expects(trace_events_ > 0);
+
+  if (heat_subcycles_ > 1 && dt_ == 0.0) {
+    throw std::runtime_error{"<heat_fluids><subcycles> requires <coupling><dt>"};
+  }
+  if (end_time_ < std::numeric_limits<double>::infinity() && dt_ == 0.0) {
+    throw std::runtime_error{"<end_time> requires <dt>"};
+  }
+  if (adaptive_dt_) {
+    if (dt_ == 0.0) {
+      throw std::runtime_error{"<adaptive_dt> requires <dt>"};
+    }
+    Expects(dt_min_ > 0 && dt_min_ <= dt_ && dt_ <= dt_max_);
+    Expects(dt_grow_ >= 1.0);
+    Expects(dt_shrink_ > 0.0 && dt_shrink_ < 1.0);
+    Expects(dt_fast_iterations_ > 0);
+  }
 
   // Create communicators
   std::array<int, 2> nodes{neut_node.child("nodes").text().as_int(),
                            heat_node.child("nodes").text().as_int()};
   std::array<int, 2> procs_per_node{neut_node.child("procs_per_node").text().as_int(),
                                     heat_node.child("procs_per_node").text().as_int()};
+  if (communication_ != Communication::partitioned) {
+    if (nodes[0] > 0 || nodes[1] > 0) {
+      throw std::runtime_error{"<nodes> can only be used with partitioned communication"};
+    }
+  }
   std::array<Comm, 2> driver_comms;
-  Comm intranode_comm; // Not used in current comm scheme
-  Comm coupling_comm;  // Not used in current comm scheme
-
-  get_driver_comms(
-    comm_, nodes, procs_per_node, driver_comms, intranode_comm, coupling_comm);
+  Comm intranode_comm;
+  Comm coupling_comm; // Not used in current comm scheme
+
+  if (communication_ == Communication::mpmd) {
+    // Each executable forms one driver, and the coupling layer runs over the merged
+    // intercommunicator in place of the given comm
+    if (procs_per_node[0] > 0 || procs_per_node[1] > 0) {
+      throw std::runtime_error{
+        "<procs_per_node> cannot be used with MPMD communication, in which the rank "
+        "counts are set by the MPI launcher"};
+    }
+    get_mpmd_comms(comm_, driver_comms, intranode_comm, comm_);
+  } else {
+    get_driver_comms(comm_,
+                     nodes,
+                     procs_per_node,
+                     placement_,
+                     driver_comms,
+                     intranode_comm,
+                     coupling_comm);
+  }
 
   auto neutronics_comm = driver_comms[0];
   auto heat_comm = driver_comms[1];
 
+  // Number of OpenMP threads per rank for each driver. With "auto", the cores on each
+  // node that are not used by the driver's ranks are divided among them. A value of 0
+  // leaves the OpenMP default in place.
+  std::array<int, 2> threads{0, 0};
+  for (const int i : {0, 1}) {
+    auto driver_node = i == 0 ? neut_node : heat_node;
+    if (!driver_node.child("threads")) {
+      continue;
+    }
+    std::string s = driver_node.child_value("threads");
+    int n = s == "auto" ? threads_per_rank(driver_comms[i], intranode_comm)
+                        : driver_node.child("threads").text().as_int();
+    if (s != "auto" && n <= 0) {
+      throw std::runtime_error{"Invalid value for <threads>"};
+    }
+    threads[i] = driver_comms[i].active() ? n : 0;
+  }
+
+  // Set the neutronics thread count before the driver is initialized, since OpenMC
+  // takes its default number of threads from the OpenMP setting. Ranks in both drivers
+  // keep the neutronics thread count, since the setting is shared by the whole process.
+  if (threads[0] > 0) {
+    set_num_threads(threads[0]);
+  } else if (threads[1] > 0) {
+    set_num_threads(threads[1]);
+  }
+
+  // Split the neutronics ranks into independent replicas. With one replica, the
+  // replica comm spans all neutronics ranks.
+  Comm replica_comm;
+  get_replica_comms(
+    neutronics_comm, n_replicas_, replica_comm, replica_roots_comm_, i_replica_);
+
   // Instantiate neutronics driver
   std::string neut_driver = neut_node.child_value("driver");
   if (neut_driver == "openmc") {
-    neutronics_driver_ = std::make_unique<OpenmcDriver>(neutronics_comm.comm);
+    auto openmc = std::make_unique<OpenmcDriver>(replica_comm.comm);
+    // Give each replica an independent random number sequence
+    if (n_replicas_ > 1 && openmc->active()) {
+      openmc->set_seed(openmc->seed() + i_replica_);
+      // Replicas share a working directory, so only the first one writes output files
+      if (i_replica_ > 0) {
+        openmc->disable_output();
+      }
+    }
+    neutronics_driver_ = std::move(openmc);
   } else if (neut_driver == "shift") {
+    if (n_replicas_ > 1) {
+      throw std::runtime_error{"Neutronics replicas are only supported with OpenMC"};
+    }
 #ifdef USE_SHIFT
     neutronics_driver_ = std::make_unique<ShiftDriver>(comm, neut_node);
 #else
@@ -140,6 +375,11 @@ CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
     throw std::runtime_error{"Invalid value for <neutronics><driver>"};
   }
 
+  // Pin the OpenMP threads of each neutronics rank to the CPUs it is bound to
+  if (neut_node.child("bind_threads").text().as_bool() && neutronics_comm.active()) {
+    bind_threads();
+  }
+
   // Instantiate heat-fluids driver
   std::string s = heat_node.child_value("driver");
   if (s == "nek5000") {
@@ -163,125 +403,363 @@ CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
     throw std::runtime_error{"Invalid value for <heat_fluids><driver>"};
   }
 
-  // Send rank of neutronics root to all procs
-  neutronics_root_ = this->get_neutronics_driver().comm_.is_root() ? comm_.rank : -1;
+  // In multi-fidelity mode, a surrogate heat driver on the heat ranks is used for the
+  // first Picard iterations before handing off to the high-fidelity heat driver
+  if (heat_node.child("surrogate_predictor")) {
+    if (s == "surrogate") {
+      throw std::runtime_error{
+        "<surrogate_predictor> requires a high-fidelity <heat_fluids><driver>"};
+    }
+    auto surrogate_node = heat_node.child("surrogate_predictor");
+    surrogate_driver_ =
+      std::make_unique<SurrogateHeatDriver>(heat_comm.comm, surrogate_node);
+    surrogate_active_ = true;
+
+    handoff_epsilon_ = 10.0 * epsilon_;
+    if (surrogate_node.child("handoff_epsilon"))
+      handoff_epsilon_ = surrogate_node.child("handoff_epsilon").text().as_double();
+    max_surrogate_iter_ = max_picard_iter_ / 2;
+    if (surrogate_node.child("max_picard_iter"))
+      max_surrogate_iter_ = surrogate_node.child("max_picard_iter").text().as_int();
+
+    Expects(handoff_epsilon_ > 0);
+    Expects(max_surrogate_iter_ > 0 && max_surrogate_iter_ < max_picard_iter_);
+  }
+
+  // Send rank of neutronics root to all procs. The neutronics root is the root of the
+  // first replica.
+  neutronics_root_ = replica_roots_comm_.is_root() ? comm_.rank : -1;
   MPI_Allreduce(MPI_IN_PLACE, &neutronics_root_, 1, MPI_INT, MPI_MAX, comm_.comm);
 
   // Send rank of heat root to all procs
   heat_root_ = this->get_heat_driver().comm_.is_root() ? comm_.rank : -1;
   MPI_Allreduce(MPI_IN_PLACE, &heat_root_, 1, MPI_INT, MPI_MAX, comm_.comm);
 
-  // Send number of global elements to all procs
-  n_global_elem_ = this->get_heat_driver().n_global_elem();
+  // With a coupled timestep, each Picard iteration restarts the drivers from the
+  // state at the start of the timestep, which not every driver supports
+  if (dt_ > 0.0) {
+    int can_repeat = 1;
+    if (neutronics_driver_->active() && !neutronics_driver_->can_repeat_timestep()) {
+      can_repeat = 0;
+    }
+    if (heat_fluids_driver_->active() && !heat_fluids_driver_->can_repeat_timestep()) {
+      can_repeat = 0;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &can_repeat, 1, MPI_INT, MPI_MIN, comm_.comm);
+    can_repeat_timestep_ = can_repeat;
+    if (!can_repeat_timestep_ && max_picard_iter_ > 1) {
+      throw std::runtime_error{"The drivers cannot repeat a timestep, so <dt> requires "
+                               "<max_picard_iter> to be 1"};
+    }
+  }
+
+  // Send number of global elements to all procs. In multi-fidelity mode, the
+  // surrogate elements follow the high-fidelity elements.
+  n_hifi_elem_ = heat_fluids_driver_->n_global_elem();
+  n_global_elem_ = n_hifi_elem_;
+  if (surrogate_driver_) {
+    n_global_elem_ += surrogate_driver_->n_global_elem();
+  }
+  comm_.broadcast(n_hifi_elem_, heat_root_);
   comm_.broadcast(n_global_elem_, heat_root_);
 
   comm_report();
+  memory_checkpoint("driver initialization");
 
   init_mappings();
+  reset_frozen_cells();
+  memory_checkpoint("init_mappings");
   init_tallies();
   init_volumes();
+  memory_checkpoint("init_volumes");
 
   // elem_fluid_mask_ must be initialized before cell_fluid_mask_!
   init_elem_fluid_mask();
   init_cell_fluid_mask();
+  memory_checkpoint("fluid masks");
 
   init_temperatures();
+  memory_checkpoint("init_temperatures");
   init_densities();
+  memory_checkpoint("init_densities");
   init_heat_source();
+  init_buffers();
+  memory_checkpoint("init_heat_source");
+
+  // Set the initial temperature and density of the neutronics cells
+  send_fields();
+  report_data_memory();
+
+  if (!history_file_.empty()) {
+    history_ = std::make_unique<FieldHistory>(comm_, history_file_);
+  }
+
+  // Start the timelines of all ranks together
+  if (!trace_file_.empty()) {
+    comm_.Barrier();
+    start_tracing(trace_events_);
+  }
 }
 
 void CoupledDriver::execute()
 {
   auto& neutronics = get_neutronics_driver();
-  auto& heat = get_heat_driver();
 
   // loop over time steps
-  for (i_timestep_ = 0; i_timestep_ < max_timesteps_; ++i_timestep_) {
+  i_timestep_ = 0;
+  while (i_timestep_ < max_timesteps_ && time_ < end_time_ - 1.0e-9 * dt_) {
     std::string msg = "i_timestep: " + std::to_string(i_timestep_);
     comm_.message(msg);
 
+    // The last timestep ends at the end time
+    if (time_ + dt_ > end_time_) {
+      dt_ = end_time_ - time_;
+    }
+
+    // Aitken relaxation restarts from alpha_max_ in each timestep
+    aitken_q_.has_residual = false;
+    aitken_T_.has_residual = false;
+    aitken_rho_.has_residual = false;
+
+    // Cells settled in the previous timestep may change again
+    reset_frozen_cells();
+
+    // Start the Picard iteration from fields extrapolated from previous timesteps
+    if (predictor_order_ > 0 && i_timestep_ > 0) {
+      predict_fields();
+    }
+
+    if (dt_ > 0.0) {
+      begin_timestep();
+    }
+
+    // Changes of the temperature that grow in consecutive Picard iterations indicate
+    // that the timestep is too long for the iteration to converge
+    bool converged = false;
+    double last_norm = std::numeric_limits<double>::infinity();
+    int n_increases = 0;
+
     // loop over picard iterations
     for (i_picard_ = 0; i_picard_ < max_picard_iter_; ++i_picard_) {
       std::string msg = "i_picard: " + std::to_string(i_picard_);
       comm_.message(msg);
 
+      if (dt_ > 0.0 && i_picard_ > 0) {
+        repeat_timestep();
+      }
+
       if (neutronics.active()) {
+        TraceScope trace{"neutronics step"};
         neutronics.init_step();
         neutronics.solve_step();
-        neutronics.write_step(i_timestep_, i_picard_);
+        // Replicas share a working directory, so only the first one writes output
+        if (i_replica_ == 0) {
+          neutronics.write_step(i_timestep_, i_picard_);
+        }
         neutronics.finalize_step();
       }
+      if (i_timestep_ == 0 && i_picard_ == 0 && memory_report_) {
+        report_memory(neutronics.comm_, "neutronics, after first solve");
+      }
+
+      barrier();
 
-      comm_.Barrier();
+      // Heap allocations made while exchanging fields, excluding the solvers
+      std::size_t n_allocations = 0;
 
       // Update heat source.
       // On the first iteration, there is no previous iterate of heat source,
       // so we can't apply underrelaxation at that point
-      update_heat_source(i_timestep_ > 0 || i_picard_ > 0);
+      {
+        AllocationScope scope{n_allocations};
+        update_heat_source(i_timestep_ > 0 || i_picard_ > 0);
+      }
 
-      if (heat.active()) {
-        heat.init_step();
-        heat.solve_step();
-        heat.write_step(i_timestep_, i_picard_);
-        heat.finalize_step();
+      solve_heat();
+      auto& heat = get_heat_driver();
+      if (i_timestep_ == 0 && i_picard_ == 0 && memory_report_) {
+        report_memory(heat.comm_, "heat-fluids, after first solve");
       }
 
-      comm_.Barrier();
+      barrier();
 
       // Update temperature and density
       // At this point, there is always a previous iterate of temperature and density
       // (as assured by the initial conditions set in init_temperature and init_density)
       // so we always apply underrelaxation here.
-      update_temperature(true);
-      update_density(true);
+      {
+        AllocationScope scope{n_allocations};
+        update_fields(true);
+      }
+
+      if (COUNT_ALLOCATIONS) {
+        long n = n_allocations;
+        MPI_Allreduce(MPI_IN_PLACE, &n, 1, MPI_LONG, MPI_MAX, comm_.comm);
+        comm_.message("heap allocations in field exchange: " + std::to_string(n));
+      }
+
+      if (freeze_tolerance_ > 0.0) {
+        update_frozen_cells();
+      }
 
-      if (is_converged()) {
+      converged = is_converged();
+      write_history();
+      if (surrogate_active_) {
+        // The surrogate only provides a starting point for the high-fidelity driver,
+        // so hand off once its iterations are close to convergence
+        if (temperature_norm_ < handoff_epsilon_ ||
+            i_picard_ + 1 >= max_surrogate_iter_) {
+          handoff_to_high_fidelity();
+        }
+      } else if (converged) {
         std::string msg = "converged at i_picard = " + std::to_string(i_picard_);
         comm_.message(msg);
         break;
       }
+
+      n_increases = temperature_norm_ > last_norm ? n_increases + 1 : 0;
+      last_norm = temperature_norm_;
+      if (adaptive_dt_ && !surrogate_active_ && n_increases >= 2) {
+        comm_.message("Picard iteration diverging at i_picard = " +
+                      std::to_string(i_picard_));
+        break;
+      }
     }
-    comm_.Barrier();
+
+    // A rejected timestep is repeated with a shorter dt from the state at its start
+    int n_iterations = std::min(i_picard_ + 1, max_picard_iter_);
+    double dt = dt_;
+    if (adaptive_dt_ && !adapt_timestep(converged, n_iterations)) {
+      repeat_timestep();
+      restore_fields();
+      continue;
+    }
+
+    if (predictor_order_ > 0) {
+      save_field_history(dt);
+    }
+
+    // Keep the heat source of this timestep, from which the heat source of the
+    // sub-steps of the next timestep is interpolated
+    if (interpolate_heat_source_ && get_heat_driver().active()) {
+      heat_source_start_ = heat_source_;
+    }
+    time_ += dt;
+    ++i_timestep_;
+    barrier();
+  }
+  get_heat_driver().write_step();
+
+  if (!trace_file_.empty()) {
+    write_trace(comm_.comm, trace_file_);
   }
-  heat.write_step();
 }
 
-double CoupledDriver::temperature_norm(Norm norm)
+template<class E>
+double CoupledDriver::compute_norm(const xt::xexpression<E>& values, Norm norm)
 {
+  // The norms are reduced directly from the expression, without evaluating it into a
+  // temporary tensor
+  const auto& v = values.derived_cast();
   switch (norm) {
   case Norm::L1: {
-    return xt::norm_l1(temperatures_ - temperatures_prev_)();
+    return xt::norm_l1(v)();
   }
   case Norm::L2: {
-    return xt::norm_l2(temperatures_ - temperatures_prev_)();
+    return xt::norm_l2(v)();
   }
   default: {
-    return xt::norm_linf(temperatures_ - temperatures_prev_)();
+    return xt::norm_linf(v)();
   }
   }
 }
 
+double CoupledDriver::temperature_norm(Norm norm)
+{
+  return compute_norm(temperatures_ - temperatures_prev_, norm);
+}
+
+double CoupledDriver::density_norm(Norm norm)
+{
+  return compute_norm(densities_ - densities_prev_, norm);
+}
+
+double CoupledDriver::heat_source_norm(Norm norm)
+{
+  return compute_norm(heat_source_ - heat_source_prev_, norm) /
+         compute_norm(heat_source_, norm);
+}
+
+double CoupledDriver::heat_source_noise_ratio() const
+{
+  // Cells without a tally uncertainty cannot be judged, so if no cell has one, the
+  // change is never considered insignificant. The change is the difference of two
+  // independent estimates with about the same standard deviation s, so its standard
+  // deviation is sqrt(2) s.
+  bool has_std_dev = false;
+  double ratio = 0.0;
+  for (gsl::index i = 0; i < heat_source_.size(); ++i) {
+    double s = std::sqrt(2.0) * heat_source_std_dev_(i);
+    if (s > 0.0) {
+      has_std_dev = true;
+      ratio = std::max(ratio, std::abs(heat_source_(i) - heat_source_prev_(i)) / s);
+    }
+  }
+  return has_std_dev ? ratio : std::numeric_limits<double>::infinity();
+}
+
 bool CoupledDriver::is_converged()
 {
-  bool converged;
-  double norm;
+  TraceScope trace{"CoupledDriver::is_converged"};
+  double norm_T;
+  double norm_rho;
 
-  // The heat root has the global temperature data
+  // The heat root has the global temperature and density data
   if (comm_.rank == heat_root_) {
-    norm = this->temperature_norm(norm_);
-    converged = norm < epsilon_;
+    norm_T = this->temperature_norm(norm_);
+    norm_rho = this->density_norm(norm_);
   }
+  comm_.broadcast(norm_T, heat_root_);
+  comm_.broadcast(norm_rho, heat_root_);
+  temperature_norm_ = norm_T;
+  density_norm_ = norm_rho;
+
+  // The neutronics root has the global heat source data. On the first iteration of the
+  // first timestep, there is no previous iterate of heat source.
+  bool has_prev_q = i_timestep_ > 0 || i_picard_ > 0;
+  double norm_q = std::numeric_limits<double>::infinity();
+  if (has_prev_q && comm_.rank == neutronics_root_) {
+    norm_q = this->heat_source_norm(norm_);
+  }
+  comm_.broadcast(norm_q, neutronics_root_);
+  heat_source_norm_ = norm_q;
 
-  comm_.broadcast(converged, heat_root_);
-  comm_.broadcast(norm, heat_root_);
+  comm_.message("temperature norm: " + std::to_string(norm_T));
+  comm_.message("density norm: " + std::to_string(norm_rho));
+  if (has_prev_q) {
+    comm_.message("relative heat source norm: " + std::to_string(norm_q));
+  }
 
-  std::string msg = "temperature norm: " + std::to_string(norm);
-  comm_.message(msg);
-  return converged;
+  // A tolerance of infinity means that the field is not checked
+  bool q_converged = std::isinf(epsilon_q_) || norm_q < epsilon_q_;
+
+  // Once the heat source only changes by tally noise, further iterations cannot
+  // reduce the change, so the heat source is considered converged
+  if (heat_source_noise_ > 0.0 && has_prev_q) {
+    comm_.message("heat source change in standard deviations: " +
+                  std::to_string(heat_source_noise_ratio_));
+    if (heat_source_noise_ratio_ <= heat_source_noise_) {
+      comm_.message("heat source change is statistically insignificant");
+      q_converged = true;
+    }
+  }
+
+  return norm_T < epsilon_ && norm_rho < epsilon_rho_ && q_converged;
 }
 
 void CoupledDriver::update_heat_source(bool relax)
 {
+  TraceScope trace{"CoupledDriver::update_heat_source"};
   auto& neutronics = this->get_neutronics_driver();
   auto& heat = this->get_heat_driver();
 
@@ -296,150 +774,702 @@ void CoupledDriver::update_heat_source(bool relax)
   }
 
   if (neutronics.active()) {
-    heat_source_ = neutronics.heat_source(power_);
+    neutronics.heat_source(power_, heat_source_);
+    if (heat_source_noise_ > 0.0) {
+      neutronics.heat_source_std_dev(power_, heat_source_std_dev_);
+    }
+    if (n_replicas_ > 1) {
+      reduce_replica_heat_source();
+    }
+  }
+
+  // The tally noise only describes the tallied heat source, so the change is judged
+  // before underrelaxation damps it
+  if (relax && heat_source_noise_ > 0.0) {
+    double noise_ratio = std::numeric_limits<double>::infinity();
+    if (comm_.rank == neutronics_root_) {
+      noise_ratio = this->heat_source_noise_ratio();
+    }
+    comm_.broadcast(noise_ratio, neutronics_root_);
+    heat_source_noise_ratio_ = noise_ratio;
   }
 
   // Compute the next iterate of the heat source
+  double alpha = alpha_;
   if (relax && comm_.rank == neutronics_root_) {
-    if (alpha_ == ROBBINS_MONRO) {
-      int n = i_picard_ + 1;
-      heat_source_ = heat_source_ / n + (1. - 1. / n) * heat_source_prev_;
-    } else {
-      heat_source_ = alpha_ * heat_source_ + (1.0 - alpha_) * heat_source_prev_;
-    }
+    alpha = relax_field(heat_source_, heat_source_prev_, alpha_, aitken_q_);
+  }
+  if (relax && alpha_ == AITKEN) {
+    report_relaxation("heat source", alpha, neutronics_root_);
   }
 
   // ****************************************************************************
   // Send underrelaxed heat source to all heat ranks and set element temperatures
   // ****************************************************************************
 
-  this->comm_.send_and_recv(heat_source_, heat_root_, neutronics_root_);
-  heat.comm_.broadcast(heat_source_);
+  if (transfer_precision_ == Precision::full) {
+    this->comm_.send_and_recv(heat_source_, heat_root_, neutronics_root_);
+    heat.comm_.broadcast(heat_source_);
+  } else {
+    // The heat source is only converted for the transfer. The neutronics root keeps
+    // the full-precision heat source for relaxation.
+    auto& compact = compact_heat_source_;
+    if (comm_.rank == neutronics_root_) {
+      compact.encode(gsl::span<const double>(heat_source_.data(), heat_source_.size()));
+    }
+    compact.send_and_recv(comm_, heat_root_, neutronics_root_);
+    compact.broadcast(heat.comm_);
+    if (heat.active() && comm_.rank != neutronics_root_) {
+      compact.decode(gsl::span<double>(heat_source_.data(), heat_source_.size()));
+    }
+    report_transfer_error("heat source", compact.max_error(0), neutronics_root_);
+  }
 
   if (heat.active()) {
-    // Determine displacement for this rank
-    auto displacement = heat.local_displs_.at(heat.comm_.rank);
-    int n_local_elem = heat.n_local_elem();
-    // Set heat source in every element
-    for (int32_t local_elem = 0; local_elem < n_local_elem; ++local_elem) {
-      int32_t global_elem = local_elem + displacement;
-      // Get heat source for this element
-      CellHandle cell = elem_to_cell_.at(global_elem);
-      err_chk(heat.set_heat_source_at(local_elem, heat_source_.at(cell)),
-              "Error setting heat source for local element " +
-                std::to_string(local_elem));
+    set_element_heat_source(1.0);
+  }
+}
+
+void CoupledDriver::set_element_heat_source(double weight)
+{
+  auto& heat = this->get_heat_driver();
+
+  // Determine displacement for this rank. In multi-fidelity mode, the surrogate
+  // elements follow the high-fidelity elements.
+  auto displacement = heat.local_displs_.at(heat.comm_.rank);
+  if (surrogate_active_) {
+    displacement += n_hifi_elem_;
+  }
+  if (heat_source_start_.size() == 0) {
+    weight = 1.0;
+  }
+
+  int32_t n_local_elem = heat.n_local_elem();
+  int n_errors = 0;
+  // Set heat source in every element
+#pragma omp parallel for reduction(+ : n_errors)
+  for (int32_t local_elem = 0; local_elem < n_local_elem; ++local_elem) {
+    int32_t global_elem = local_elem + displacement;
+    // Get heat source for this element. Elements in frozen cells keep their
+    // previous heat source.
+    CellHandle cell = elem_to_cell_[global_elem];
+    if (cell_frozen_[cell]) {
+      continue;
+    }
+    double q = heat_source_[cell];
+    if (weight < 1.0) {
+      q = weight * q + (1.0 - weight) * heat_source_start_[cell];
+    }
+    if (heat.set_heat_source_at(local_elem, q) != 0) {
+      ++n_errors;
     }
   }
+  err_chk(n_errors == 0,
+          "Error setting heat source for " + std::to_string(n_errors) +
+            " local elements");
 }
 
-void CoupledDriver::update_temperature(bool relax)
+void CoupledDriver::solve_heat()
 {
-  comm_.message("Updating temperature");
+  auto& heat = this->get_heat_driver();
+
+  if (heat_subcycles_ == 1) {
+    if (heat.active()) {
+      TraceScope trace{"heat step"};
+      heat.init_step();
+      heat.solve_step();
+      heat.write_step(i_timestep_, i_picard_);
+      heat.finalize_step();
+    }
+    return;
+  }
+
+  // Each sub-step advances the heat driver by a fraction of the coupled timestep. The
+  // temperature and density of each sub-step are summed on the heat root.
+  auto& records = buffers_.elem_fields;
+  auto& sum = buffers_.subcycle_sum;
+  gsl::span<ElementFields> segment;
+  if (comm_.rank == heat_root_) {
+    records.resize(n_active_heat_elem());
+    sum.assign(records.size(), ElementFields{});
+    segment = gsl::span<ElementFields>(records);
+  }
+
+  double dt = dt_ / heat_subcycles_;
+  for (int m = 0; m < heat_subcycles_; ++m) {
+    if (heat.active()) {
+      TraceScope trace{"heat step"};
+      // The heat source is evaluated at the midpoint of the sub-step
+      if (interpolate_heat_source_) {
+        set_element_heat_source((m + 0.5) / heat_subcycles_);
+      }
+      heat.set_timestep(time_ + m * dt, dt);
+      heat.init_step();
+      heat.solve_step();
+      heat.finalize_step();
+    }
+
+    heat.fields(segment);
+    if (comm_.rank == heat_root_) {
+      for (gsl::index i = 0; i < records.size(); ++i) {
+        sum[i].temperature += records[i].temperature;
+        sum[i].density += records[i].density;
+      }
+    }
+  }
+  if (heat.active()) {
+    heat.write_step(i_timestep_, i_picard_);
+  }
 
+  // Leave the averages over the sub-steps for update_fields()
+  if (comm_.rank == heat_root_) {
+    for (gsl::index i = 0; i < records.size(); ++i) {
+      records[i].temperature = sum[i].temperature / heat_subcycles_;
+      records[i].density = sum[i].density / heat_subcycles_;
+    }
+  }
+}
+
+void CoupledDriver::set_cell_temperatures()
+{
+  auto& neutronics = this->get_neutronics_driver();
+
+  // For each neutronics cell that is not frozen, volume average temperatures and set
+  auto& averages = buffers_.cell_values;
+  cell_averages(temperatures_, false, averages);
+  for (CellHandle cell = 0; cell < n_cells_; ++cell) {
+    if (!is_cell_updated(cell, false)) {
+      continue;
+    }
+    double average_temp = averages[cell];
+    Ensures(average_temp > 0.0);
+
+    // Set temperature for cell instance
+    neutronics.set_temperature(cell, average_temp);
+    if (freeze_tolerance_ > 0.0) {
+      cell_temperatures_(cell) = average_temp;
+    }
+  }
+}
+
+void CoupledDriver::set_cell_densities()
+{
   auto& neutronics = this->get_neutronics_driver();
+
+  // For each neutronics cell in a fluid cell that is not frozen, volume average the
+  // densities and set in driver
+  auto& averages = buffers_.cell_values;
+  cell_averages(densities_, true, averages);
+  for (CellHandle cell : fluid_cells_) {
+    if (is_cell_updated(cell, true)) {
+      // Set density for cell instance
+      double average_density = averages[cell];
+      Ensures(average_density > 0.0);
+      neutronics.set_density(cell, average_density);
+      if (freeze_tolerance_ > 0.0) {
+        cell_densities_(cell) = average_density;
+      }
+    }
+  }
+}
+
+void CoupledDriver::update_fields(bool relax)
+{
+  TraceScope trace{"CoupledDriver::update_fields"};
+  comm_.message("Updating temperature and density");
+
   auto& heat = this->get_heat_driver();
 
   // *************************************************************************
-  // Gather temperature on heat root and apply underrelaxation
+  // Gather temperature and density on heat root and apply underrelaxation
   // *************************************************************************
 
   if (relax && comm_.rank == heat_root_) {
-    // Store previous temperature solution; a previous solution will always be present
-    // because a temperature IC is set and the neutronics solver runs first
     std::copy(temperatures_.begin(), temperatures_.end(), temperatures_prev_.begin());
+    std::copy(densities_.begin(), densities_.end(), densities_prev_.begin());
   }
 
-  temperatures_ = heat.temperature();
+  // The temperature and density of each element are gathered together in a single
+  // record. Only the elements of the heat driver currently used for coupling are
+  // updated. With subcycling, the records already hold the averages over the heat
+  // sub-steps.
+  auto& records = buffers_.elem_fields;
+  if (heat_subcycles_ == 1) {
+    gsl::span<ElementFields> segment;
+    if (comm_.rank == heat_root_) {
+      records.resize(n_active_heat_elem());
+      segment = gsl::span<ElementFields>(records);
+    }
+    heat.fields(segment);
+  }
+  if (comm_.rank == heat_root_) {
+    auto offset = active_heat_offset();
+    for (gsl::index i = 0; i < records.size(); ++i) {
+      temperatures_(offset + i) = records[i].temperature;
+      densities_(offset + i) = records[i].density;
+    }
+  }
 
+  double alpha_T = alpha_T_;
+  double alpha_rho = alpha_rho_;
   if (relax && comm_.rank == heat_root_) {
-    if (alpha_T_ == ROBBINS_MONRO) {
-      int n = i_picard_ + 1;
-      temperatures_ = temperatures_ / n + (1. - 1. / n) * temperatures_prev_;
-    } else {
-      temperatures_ = alpha_T_ * temperatures_ + (1.0 - alpha_T_) * temperatures_prev_;
-    }
+    alpha_T = relax_field(temperatures_, temperatures_prev_, alpha_T_, aitken_T_);
+    alpha_rho = relax_field(densities_, densities_prev_, alpha_rho_, aitken_rho_);
+  }
+  if (relax && alpha_T_ == AITKEN) {
+    report_relaxation("temperature", alpha_T, heat_root_);
   }
+  if (relax && alpha_rho_ == AITKEN) {
+    report_relaxation("density", alpha_rho, heat_root_);
+  }
+
+  send_fields();
+}
+
+void CoupledDriver::send_fields()
+{
+  TraceScope trace{"CoupledDriver::send_fields"};
+  auto& neutronics = this->get_neutronics_driver();
 
   // ****************************************************************************
-  // Send underrelaxed temperature to all neutron ranks and set cell temperatures
+  // Send underrelaxed temperature and density to all neutron ranks in one message
+  // and set cell temperatures and densities
   // ****************************************************************************
 
-  // Broadcast global_element_temperatures onto all the neutronics procs
-  comm_.send_and_recv(temperatures_, neutronics_root_, heat_root_);
-  neutronics.comm_.broadcast(temperatures_);
+  // Pack the fields of the elements in cells that are not frozen, in element order
+  auto& records = buffers_.elem_fields;
+  records.clear();
+  if (comm_.rank == heat_root_) {
+    for (gsl::index elem = 0; elem < n_global_elem_; ++elem) {
+      if (!cell_frozen_[elem_to_cell_[elem]]) {
+        records.push_back({temperatures_(elem), densities_(elem)});
+      }
+    }
+  }
+  if (transfer_precision_ == Precision::full) {
+    comm_.send_and_recv(records, neutronics_root_, heat_root_);
+    neutronics_broadcast(records);
+  } else {
+    // The records are transferred as interleaved temperatures and densities
+    static_assert(sizeof(ElementFields) == 2 * sizeof(double),
+                  "ElementFields must consist of two doubles");
+    auto& compact = compact_fields_;
+    if (comm_.rank == heat_root_) {
+      auto data = reinterpret_cast<const double*>(records.data());
+      compact.encode(gsl::span<const double>(data, 2 * records.size()));
+    }
+    compact.send_and_recv(comm_, neutronics_root_, heat_root_);
+    compact.broadcast(replica_roots_comm_);
+    compact.broadcast(neutronics.comm_);
+    if (neutronics.active() && comm_.rank != heat_root_) {
+      records.resize(compact.size() / 2);
+      auto data = reinterpret_cast<double*>(records.data());
+      compact.decode(gsl::span<double>(data, compact.size()));
+    }
+    report_transfer_error("temperature", compact.max_error(0), heat_root_);
+    report_transfer_error("density", compact.max_error(1), heat_root_);
+  }
 
   if (neutronics.active()) {
-    // For each neutronics cell, volume average temperatures and set
-    for (const auto& kv : cell_to_elems_) {
-      // Get volume-average temperature for this cell instance
-      double average_temp = 0.0;
-      double total_vol = 0.0;
-      for (int elem : kv.second) {
-        double T = temperatures_[elem];
-        double V = elem_volumes_[elem];
-        average_temp += T * V;
-        total_vol += V;
+    // Unpack the fields. Values of elements in frozen cells are stale, but they are
+    // not used until the cell is unfrozen and the fields are sent again.
+    if (comm_.rank != heat_root_) {
+      gsl::index i = 0;
+      for (gsl::index elem = 0; elem < n_global_elem_; ++elem) {
+        if (!cell_frozen_[elem_to_cell_[elem]]) {
+          temperatures_(elem) = records[i].temperature;
+          densities_(elem) = records[i].density;
+          ++i;
+        }
       }
-      average_temp /= total_vol;
-      Ensures(average_temp > 0.0);
+    }
 
-      // Set temperature for cell instance
-      CellHandle cell = kv.first;
-      neutronics.set_temperature(cell, average_temp);
+    set_cell_temperatures();
+    set_cell_densities();
+  }
+}
+
+int32_t CoupledDriver::active_heat_offset() const
+{
+  // In multi-fidelity mode, the surrogate elements follow the high-fidelity elements
+  return surrogate_active_ ? n_hifi_elem_ : 0;
+}
+
+int32_t CoupledDriver::n_active_heat_elem() const
+{
+  return surrogate_active_ ? n_global_elem_ - n_hifi_elem_ : n_hifi_elem_;
+}
+
+gsl::span<double> CoupledDriver::active_heat_segment(xt::xtensor<double, 1>& field) const
+{
+  if (comm_.rank != heat_root_) {
+    return {};
+  }
+  return gsl::span<double>(field.data() + active_heat_offset(), n_active_heat_elem());
+}
+
+bool CoupledDriver::is_cell_updated(CellHandle cell, bool fluid_only) const
+{
+  return cell_elem_offsets_[cell + 1] > cell_elem_offsets_[cell] &&
+         !cell_frozen_[cell] && (!fluid_only || cell_fluid_mask_[cell]);
+}
+
+void CoupledDriver::cell_averages(const xt::xtensor<double, 1>& field,
+                                  bool fluid_only,
+                                  std::vector<double>& averages) const
+{
+  Expects(averages.size() == n_cells_);
+
+  // Each cell is averaged by a single thread in element order, so the result does not
+  // depend on the number of threads. When only fluid cells are needed, the list of
+  // fluid cells is visited instead of all cells.
+  int32_t n = fluid_only ? fluid_cells_.size() : n_cells_;
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int32_t i = 0; i < n; ++i) {
+    CellHandle cell = fluid_only ? fluid_cells_[i] : i;
+    if (!is_cell_updated(cell, fluid_only)) {
+      continue;
     }
+
+    double sum = 0.0;
+    double total_vol = 0.0;
+    for (int32_t elem : cell_elems(cell)) {
+      double V = elem_volumes_[elem];
+      sum += field[elem] * V;
+      total_vol += V;
+    }
+    averages[cell] = sum / total_vol;
   }
 }
 
-void CoupledDriver::update_density(bool relax)
+void CoupledDriver::reset_frozen_cells()
 {
+  cell_frozen_ = BitMask(n_cells_);
+  n_frozen_cells_ = 0;
 
-  auto& neutronics = this->get_neutronics_driver();
-  auto& heat = this->get_heat_driver();
+  if (freeze_tolerance_ > 0.0) {
+    if (this->get_neutronics_driver().active()) {
+      cell_temperatures_ = xt::zeros<double>({static_cast<std::size_t>(n_cells_)});
+      cell_densities_ = xt::zeros<double>({static_cast<std::size_t>(n_cells_)});
+    }
+    if (comm_.rank == neutronics_root_) {
+      cell_temperatures_prev_ = cell_temperatures_;
+      cell_densities_prev_ = cell_densities_;
+      cell_settled_iters_.assign(n_cells_, 0);
+    }
+  }
+}
 
-  // *********************************************************************
-  // Gather densities on heat root and apply underrelaxation
-  // *********************************************************************
+void CoupledDriver::update_frozen_cells()
+{
+  TraceScope trace{"CoupledDriver::update_frozen_cells"};
+  // There is no previous iterate of heat source on the first iteration of the first
+  // timestep, so nothing can be judged settled yet
+  if (i_timestep_ == 0 && i_picard_ == 0) {
+    return;
+  }
 
-  if (relax && comm_.rank == heat_root_) {
-    std::copy(densities_.begin(), densities_.end(), densities_prev_.begin());
+  if (comm_.rank == neutronics_root_) {
+    auto relative_change = [](double x, double x_prev) {
+      double scale = std::max(std::abs(x), std::abs(x_prev));
+      return x == x_prev ? 0.0 : std::abs(x - x_prev) / scale;
+    };
+
+    // The heat source is tallied in every cell on every iteration, so a frozen cell
+    // whose heat source changes again is unfrozen. Cell temperatures and densities
+    // are only recomputed for cells that are not frozen and on full refreshes.
+    for (gsl::index cell = 0; cell < n_cells_; ++cell) {
+      double dq = relative_change(heat_source_(cell), heat_source_prev_(cell));
+      double dT =
+        relative_change(cell_temperatures_(cell), cell_temperatures_prev_(cell));
+      double drho = relative_change(cell_densities_(cell), cell_densities_prev_(cell));
+      if (std::max({dq, dT, drho}) < freeze_tolerance_) {
+        ++cell_settled_iters_[cell];
+      } else {
+        cell_settled_iters_[cell] = 0;
+      }
+    }
+    cell_temperatures_prev_ = cell_temperatures_;
+    cell_densities_prev_ = cell_densities_;
+
+    // Every freeze_refresh_ iterations, all cells are updated
+    bool refresh = (i_picard_ + 1) % freeze_refresh_ == 0;
+    for (gsl::index cell = 0; cell < n_cells_; ++cell) {
+      if (!refresh && cell_settled_iters_[cell] >= freeze_iterations_) {
+        cell_frozen_.set(cell);
+      } else {
+        cell_frozen_.reset(cell);
+      }
+    }
   }
 
-  densities_ = heat.density();
+  comm_.broadcast(cell_frozen_.words(), neutronics_root_);
+  n_frozen_cells_ = cell_frozen_.count();
 
-  if (relax && comm_.rank == heat_root_) {
-    if (alpha_rho_ == ROBBINS_MONRO) {
-      int n = i_picard_ + 1;
-      densities_ = densities_ / n + (1. - 1. / n) * densities_prev_;
-    } else {
-      densities_ = alpha_rho_ * densities_ + (1.0 - alpha_rho_) * densities_prev_;
+  comm_.message("frozen cells: " + std::to_string(n_frozen_cells_) + " of " +
+                std::to_string(n_cells_));
+}
+
+double CoupledDriver::relax_field(xt::xtensor<double, 1>& field,
+                                  const xt::xtensor<double, 1>& prev,
+                                  double alpha,
+                                  AitkenState& aitken) const
+{
+  if (alpha == ROBBINS_MONRO) {
+    alpha = 1.0 / (i_picard_ + 1);
+  } else if (alpha == AITKEN) {
+    alpha = aitken_factor(field, prev, aitken);
+  }
+  // The update is elementwise, so it can be computed in place without a temporary
+  xt::noalias(field) = alpha * field + (1.0 - alpha) * prev;
+  return alpha;
+}
+
+double CoupledDriver::aitken_factor(const xt::xtensor<double, 1>& field,
+                                    const xt::xtensor<double, 1>& prev,
+                                    AitkenState& aitken) const
+{
+  double alpha = alpha_max_;
+
+  // With residuals r_k and r_{k-1} from the current and previous iterations, the
+  // Aitken factor is
+  //   alpha_k = -alpha_{k-1} (r_{k-1} . (r_k - r_{k-1})) / |r_k - r_{k-1}|^2
+  if (aitken.has_residual) {
+    double numer = 0.0;
+    double denom = 0.0;
+    for (gsl::index i = 0; i < field.size(); ++i) {
+      double delta = (field(i) - prev(i)) - aitken.residual(i);
+      numer += aitken.residual(i) * delta;
+      denom += delta * delta;
     }
+    alpha = denom > 0.0 ? -aitken.alpha * numer / denom : aitken.alpha;
+    alpha = std::min(std::max(alpha, alpha_min_), alpha_max_);
   }
 
-  // ************************************************************************
-  // Send underrelaxed density to all neutron ranks and set cell temperatures
-  // ************************************************************************
+  // The residual is kept in place for the next iteration
+  if (aitken.residual.size() != field.size()) {
+    aitken.residual.resize({field.size()});
+  }
+  xt::noalias(aitken.residual) = field - prev;
+  aitken.has_residual = true;
+  aitken.alpha = alpha;
+  return alpha;
+}
 
-  comm_.send_and_recv(densities_, neutronics_root_, heat_root_);
-  neutronics.comm_.broadcast(densities_);
+void CoupledDriver::report_relaxation(const char* name, double alpha, int root) const
+{
+  comm_.broadcast(alpha, root);
 
-  if (neutronics.active()) {
-    // For each neutronics cell in a fluid cell, volume average the densities
-    // and set in driver
-    for (const auto& kv : cell_to_elems_) {
-      CellHandle cell = kv.first;
-      if (cell_fluid_mask_[cell] == 1) {
-        // Get volume-averaged density for this cell instance
-        double average_density = 0.0;
-        double total_vol = 0.0;
-        for (int e : kv.second) {
-          average_density += densities_[e] * elem_volumes_[e];
-          total_vol += elem_volumes_[e];
+  // The message is formatted in a fixed-size buffer to avoid allocating memory
+  char msg[128];
+  std::snprintf(msg, sizeof(msg), "Aitken relaxation factor for %s: %f", name, alpha);
+  comm_.message(msg);
+}
+
+void CoupledDriver::report_transfer_error(const char* name,
+                                          double error,
+                                          int root) const
+{
+  comm_.broadcast(error, root);
+
+  // The message is formatted in a fixed-size buffer to avoid allocating memory
+  char msg[128];
+  std::snprintf(msg, sizeof(msg), "max transfer error of %s: %e", name, error);
+  comm_.message(msg);
+}
+
+void CoupledDriver::begin_timestep()
+{
+  comm_.message("time: " + std::to_string(time_) + " s");
+
+  // In multi-fidelity mode, the high-fidelity heat driver may take over during the
+  // timestep, so both heat drivers are prepared
+  std::array<Driver*, 3> drivers{
+    neutronics_driver_.get(), heat_fluids_driver_.get(), surrogate_driver_.get()};
+  for (auto driver : drivers) {
+    if (driver && driver->active()) {
+      driver->set_timestep(time_, dt_);
+      driver->save_state();
+    }
+  }
+
+  // A rejected timestep must not start from the fields of its failed Picard
+  // iterations, so the coupled fields are saved along with the drivers' states
+  if (adaptive_dt_) {
+    auto& start = timestep_start_;
+    if (comm_.rank == heat_root_) {
+      start.temperatures = temperatures_;
+      start.temperatures_prev = temperatures_prev_;
+      start.densities = densities_;
+      start.densities_prev = densities_prev_;
+    }
+    if (comm_.rank == neutronics_root_) {
+      start.heat_source = heat_source_;
+      start.heat_source_prev = heat_source_prev_;
+    }
+  }
+}
+
+void CoupledDriver::repeat_timestep()
+{
+  std::array<Driver*, 3> drivers{
+    neutronics_driver_.get(), heat_fluids_driver_.get(), surrogate_driver_.get()};
+  for (auto driver : drivers) {
+    if (driver && driver->active()) {
+      driver->restore_state();
+    }
+  }
+}
+
+void CoupledDriver::restore_fields()
+{
+  const auto& start = timestep_start_;
+  if (comm_.rank == heat_root_) {
+    temperatures_ = start.temperatures;
+    temperatures_prev_ = start.temperatures_prev;
+    densities_ = start.densities;
+    densities_prev_ = start.densities_prev;
+  }
+  if (comm_.rank == neutronics_root_) {
+    heat_source_ = start.heat_source;
+    heat_source_prev_ = start.heat_source_prev;
+  }
+
+  // The neutronics cells are set from the restored fields, including cells frozen in
+  // the rejected timestep, whose tracked values are reset along with them
+  reset_frozen_cells();
+  send_fields();
+}
+
+bool CoupledDriver::adapt_timestep(bool converged, int n_iterations)
+{
+  // Lengthen the timestep after an easy timestep, and shorten it after a failed one.
+  // A failed timestep is repeated unless it is already as short as allowed or the
+  // drivers cannot repeat it.
+  double dt = dt_;
+  bool accept = true;
+  if (converged && n_iterations <= dt_fast_iterations_) {
+    dt = std::min(dt_ * dt_grow_, dt_max_);
+  } else if (!converged) {
+    dt = std::max(dt_ * dt_shrink_, dt_min_);
+    accept = !(can_repeat_timestep_ && dt_ > dt_min_);
+  }
+
+  // Timesteps are whole multiples of the shortest timestep, so that drivers with a
+  // fixed internal timestep can take whole numbers of steps
+  dt = std::max(std::floor(dt / dt_min_ + 1.0e-9), 1.0) * dt_min_;
+
+  char msg[160];
+  std::snprintf(msg,
+                sizeof(msg),
+                "Timestep %d %s at t = %g s: dt = %g s, %d Picard iterations%s; "
+                "next dt = %g s",
+                i_timestep_,
+                accept ? "accepted" : "rejected",
+                time_,
+                dt_,
+                n_iterations,
+                converged ? "" : " without convergence",
+                dt);
+  comm_.message(msg);
+
+  dt_ = dt;
+  return accept;
+}
+
+void CoupledDriver::save_field_history(double dt)
+{
+  auto save = [this](auto& history, const auto& field) {
+    history.push_front(field);
+    if (history.size() > predictor_order_ + 1) {
+      history.pop_back();
+    }
+  };
+
+  save(time_history_, predictor_time(dt));
+
+  if (comm_.rank == heat_root_) {
+    save(temperature_history_, temperatures_);
+    save(density_history_, densities_);
+  }
+  if (comm_.rank == neutronics_root_) {
+    save(heat_source_history_, heat_source_);
+  }
+}
+
+void CoupledDriver::predict_fields()
+{
+  TraceScope trace{"CoupledDriver::predict_fields"};
+  // The order is limited by the number of converged timesteps saved so far
+  int order = extrapolation_order(predictor_order_, time_history_);
+  comm_.message("Predicting fields with order " + std::to_string(order) +
+                " extrapolation");
+
+  // The weights account for timesteps of different lengths with adaptive timesteps
+  auto weights = extrapolation_weights(time_history_, order, predictor_time(dt_));
+  if (comm_.rank == heat_root_) {
+    extrapolate(temperature_history_, weights, temperatures_);
+    extrapolate(density_history_, weights, densities_);
+  }
+  if (comm_.rank == neutronics_root_) {
+    extrapolate(heat_source_history_, weights, heat_source_);
+  }
+
+  // The neutronics solver runs first in each timestep, so it needs the predicted
+  // temperature and density. The predicted heat source only enters through the
+  // underrelaxation of the next heat source update.
+  send_fields();
+}
+
+void CoupledDriver::reduce_replica_heat_source()
+{
+  TraceScope trace{"CoupledDriver::reduce_replica_heat_source"};
+  auto& neutronics = this->get_neutronics_driver();
+
+  // Weight each replica's heat source by its number of realizations. Every rank in a
+  // replica takes part in determining the number of realizations.
+  double m = neutronics.n_realizations();
+
+  // The variance of the weighted mean is the sum of the replica variances, each
+  // weighted by the square of the replica's number of realizations
+  bool has_std_dev = heat_source_noise_ > 0.0;
+
+  if (replica_roots_comm_.active()) {
+    for (auto& q : heat_source_) {
+      q *= m;
+    }
+    if (has_std_dev) {
+      for (auto& s : heat_source_std_dev_) {
+        s = m * m * s * s;
+      }
+    }
+
+    // Sum weighted heat sources, variances, and weights on the neutronics root
+    int n = heat_source_.size();
+    if (replica_roots_comm_.is_root()) {
+      replica_roots_comm_.Reduce(
+        MPI_IN_PLACE, heat_source_.data(), n, MPI_DOUBLE, MPI_SUM);
+      if (has_std_dev) {
+        replica_roots_comm_.Reduce(
+          MPI_IN_PLACE, heat_source_std_dev_.data(), n, MPI_DOUBLE, MPI_SUM);
+      }
+      replica_roots_comm_.Reduce(MPI_IN_PLACE, &m, 1, MPI_DOUBLE, MPI_SUM);
+      for (auto& q : heat_source_) {
+        q /= m;
+      }
+      if (has_std_dev) {
+        for (auto& s : heat_source_std_dev_) {
+          s = std::sqrt(s) / m;
         }
-        // Set density for cell instance
-        average_density /= total_vol;
-        Ensures(average_density > 0.0);
-        neutronics.set_density(cell, average_density);
       }
+    } else {
+      replica_roots_comm_.Reduce(
+        heat_source_.data(), nullptr, n, MPI_DOUBLE, MPI_SUM);
+      if (has_std_dev) {
+        replica_roots_comm_.Reduce(
+          heat_source_std_dev_.data(), nullptr, n, MPI_DOUBLE, MPI_SUM);
+      }
+      replica_roots_comm_.Reduce(&m, nullptr, 1, MPI_DOUBLE, MPI_SUM);
     }
   }
 }
@@ -451,32 +1481,135 @@ void CoupledDriver::init_mappings()
   const auto& heat = this->get_heat_driver();
   auto& neutronics = this->get_neutronics_driver();
 
-  // Get centroids from heat driver and send to all neutronics procs
-  auto elem_centroids = heat.centroids();
+  // Get centroids from heat driver(s)
+  auto elem_centroids = gather_heat_field(&HeatFluidsDriver::centroids);
+
+  // In multi-fidelity mode, locate each high-fidelity element in the surrogate model
+  if (surrogate_driver_ && comm_.rank == heat_root_) {
+    hifi_to_surrogate_.resize(n_hifi_elem_);
+    for (int32_t elem = 0; elem < n_hifi_elem_; ++elem) {
+      hifi_to_surrogate_[elem] = surrogate_driver_->element_at(elem_centroids[elem]);
+    }
+  }
+
+  // Send centroids to all neutronics procs
   comm_.send_and_recv(elem_centroids, neutronics_root_, heat_root_);
-  neutronics.comm_.broadcast(elem_centroids);
+  neutronics_broadcast(elem_centroids);
 
   if (neutronics.active()) {
     // Get cell handle corresponding to each element centroid
     elem_to_cell_ = neutronics.find(elem_centroids);
 
-    // Create a vector of elements for each neutronics cell
-    for (int32_t elem = 0; elem < elem_to_cell_.size(); ++elem) {
-      auto cell = elem_to_cell_[elem];
-      cell_to_elems_[cell].push_back(elem);
-    }
-
     // Determine number of neutronic cell instances
-    n_cells_ = cell_to_elems_.size();
+    std::unordered_set<CellHandle> cells(elem_to_cell_.begin(), elem_to_cell_.end());
+    n_cells_ = cells.size();
+
+    if (cell_order_ != CellOrder::find) {
+      reorder_cells(elem_centroids);
+    }
   }
 
+  // Create a vector of elements for each neutronics cell
+  init_cell_to_elems();
+
   // Send element -> cell instance mapping to all heat procs
   comm_.send_and_recv(elem_to_cell_, heat_root_, neutronics_root_);
   heat.comm_.broadcast(elem_to_cell_);
 
-  // Send number of cell instances to all heat procs
-  comm_.send_and_recv(n_cells_, heat_root_, neutronics_root_);
-  heat.comm_.broadcast(n_cells_);
+  // Send number of cell instances to all procs
+  comm_.broadcast(n_cells_, neutronics_root_);
+}
+
+void CoupledDriver::init_cell_to_elems()
+{
+  if (this->get_neutronics_driver().active()) {
+    int32_t begin = surrogate_active_ ? n_hifi_elem_ : 0;
+    int32_t end = surrogate_active_ ? n_global_elem_ : n_hifi_elem_;
+
+    // Count the elements of each cell, then place the elements of each cell
+    // contiguously in ascending order (a counting sort by cell)
+    cell_elem_offsets_.assign(n_cells_ + 1, 0);
+    for (int32_t elem = begin; elem < end; ++elem) {
+      ++cell_elem_offsets_[elem_to_cell_[elem] + 1];
+    }
+    for (CellHandle cell = 0; cell < n_cells_; ++cell) {
+      cell_elem_offsets_[cell + 1] += cell_elem_offsets_[cell];
+    }
+
+    cell_elems_.resize(end - begin);
+    std::vector<int32_t> next(cell_elem_offsets_.begin(), cell_elem_offsets_.end() - 1);
+    for (int32_t elem = begin; elem < end; ++elem) {
+      cell_elems_[next[elem_to_cell_[elem]]++] = elem;
+    }
+  }
+}
+
+void CoupledDriver::reorder_cells(const std::vector<Position>& elem_centroids)
+{
+  // Each cell is represented by the mean of the centroids of its elements. Every
+  // neutronics rank computes the same order from the same centroids.
+  std::vector<Position> cell_centroids(n_cells_);
+  std::vector<int32_t> n_elems(n_cells_, 0);
+  for (gsl::index elem = 0; elem < elem_to_cell_.size(); ++elem) {
+    auto& c = cell_centroids[elem_to_cell_[elem]];
+    const auto& r = elem_centroids[elem];
+    c.x += r.x;
+    c.y += r.y;
+    c.z += r.z;
+    ++n_elems[elem_to_cell_[elem]];
+  }
+  for (CellHandle cell = 0; cell < n_cells_; ++cell) {
+    auto& c = cell_centroids[cell];
+    c = {c.x / n_elems[cell], c.y / n_elems[cell], c.z / n_elems[cell]};
+  }
+
+  auto order = curve_order(cell_centroids, cell_order_);
+  this->get_neutronics_driver().reorder_cells(order);
+
+  std::vector<CellHandle> new_handle(n_cells_);
+  for (CellHandle cell = 0; cell < n_cells_; ++cell) {
+    new_handle[order[cell]] = cell;
+  }
+  for (auto& cell : elem_to_cell_) {
+    cell = new_handle[cell];
+  }
+}
+
+void CoupledDriver::handoff_to_high_fidelity()
+{
+  TraceScope trace{"CoupledDriver::handoff_to_high_fidelity"};
+  comm_.message("Switching from surrogate to high-fidelity heat driver");
+  surrogate_active_ = false;
+
+  // Warm start each high-fidelity element from the surrogate element containing its
+  // centroid. Elements without a surrogate counterpart keep their current values.
+  if (comm_.rank == heat_root_) {
+    for (int32_t elem = 0; elem < n_hifi_elem_; ++elem) {
+      int32_t surrogate_elem = hifi_to_surrogate_[elem];
+      if (surrogate_elem < 0) {
+        continue;
+      }
+      surrogate_elem += n_hifi_elem_;
+
+      temperatures_(elem) = temperatures_(surrogate_elem);
+      if (elem_fluid_mask_[elem] && elem_fluid_mask_[surrogate_elem]) {
+        densities_(elem) = densities_(surrogate_elem);
+      }
+    }
+    std::copy(temperatures_.begin(), temperatures_.end(), temperatures_prev_.begin());
+    std::copy(densities_.begin(), densities_.end(), densities_prev_.begin());
+  }
+
+  // Residuals from the surrogate iterations say nothing about the high-fidelity driver
+  aitken_q_.has_residual = false;
+  aitken_T_.has_residual = false;
+  aitken_rho_.has_residual = false;
+
+  // Neutronics cells now average over the high-fidelity elements
+  init_cell_to_elems();
+  init_cell_fluid_mask();
+  reset_frozen_cells();
+  send_fields();
 }
 
 void CoupledDriver::init_tallies()
@@ -494,7 +1627,7 @@ void CoupledDriver::init_temperatures()
   comm_.message("Initializing temperatures");
 
   const auto& neutronics = this->get_neutronics_driver();
-  const auto& heat = this->get_heat_driver();
+  auto& heat = this->get_heat_driver();
 
   if (comm_.rank == heat_root_) {
     temperatures_.resize({static_cast<unsigned long>(n_global_elem_)});
@@ -509,7 +1642,9 @@ void CoupledDriver::init_temperatures()
       // corresponding neutronics cell. This mapping assumes that each
       // heat-fluids element is fully contained within a neutronic cell, i.e.,
       // heat-fluids elements are not split between multiple neutronics cells.
-      for (gsl::index elem = 0; elem < elem_to_cell_.size(); ++elem) {
+      gsl::index n_elem = elem_to_cell_.size();
+#pragma omp parallel for
+      for (gsl::index elem = 0; elem < n_elem; ++elem) {
         auto cell = elem_to_cell_[elem];
         double T = neutronics.get_temperature(cell);
         temperatures_[elem] = T;
@@ -517,11 +1652,17 @@ void CoupledDriver::init_temperatures()
     }
     comm_.send_and_recv(temperatures_, heat_root_, neutronics_root_);
   } else if (temperature_ic_ == Initial::heat) {
-    // * This sets temperatures_ on the the coupling_root, based on the
-    //   temperatures received from the heat solver.
-    // * We do not want to apply underrelaxation here (and at this point,
-    //   there is no previous iterate of temperature, anyway).
-    update_temperature(false);
+    // In multi-fidelity mode, the active heat driver only sets the surrogate elements
+    if (surrogate_driver_) {
+      auto T = heat_fluids_driver_->temperature();
+      if (comm_.rank == heat_root_) {
+        std::copy(T.begin(), T.end(), temperatures_.begin());
+      }
+    }
+
+    // This sets temperatures_ on the heat root, based on the temperatures received
+    // from the heat solver. The neutronics ranks receive them in send_fields().
+    heat.temperature(active_heat_segment(temperatures_));
   }
 
   // In both cases, only temperatures_ was set, so we explicitly set temperatures_prev_
@@ -534,21 +1675,23 @@ void CoupledDriver::init_volumes()
 {
   comm_.message("Initializing volumes");
 
-  const auto& heat = this->get_heat_driver();
   const auto& neutronics = this->get_neutronics_driver();
 
   // Gather all the element volumes on heat root and send to all neutronics procs
-  elem_volumes_ = heat.volumes();
+  elem_volumes_ = gather_heat_field(&HeatFluidsDriver::volumes);
   this->comm_.send_and_recv(elem_volumes_, neutronics_root_, heat_root_);
-  neutronics.comm_.broadcast(elem_volumes_);
+  neutronics_broadcast(elem_volumes_);
 
   // Volume check
-  if (neutronics.comm_.is_root()) {
-    for (const auto& kv : cell_to_elems_) {
-      CellHandle cell = kv.first;
+  if (comm_.rank == neutronics_root_) {
+    for (CellHandle cell = 0; cell < n_cells_; ++cell) {
+      auto elems = cell_elems(cell);
+      if (elems.empty()) {
+        continue;
+      }
       double v_neutronics = neutronics.get_volume(cell);
       double v_heatfluids = 0.0;
-      for (const auto& elem : kv.second) {
+      for (const auto& elem : elems) {
         v_heatfluids += elem_volumes_.at(elem);
       }
 
@@ -566,7 +1709,7 @@ void CoupledDriver::init_densities()
   comm_.message("Initializing densities");
 
   const auto& neutronics = this->get_neutronics_driver();
-  const auto& heat = this->get_heat_driver();
+  auto& heat = this->get_heat_driver();
 
   if (comm_.rank == heat_root_) {
     densities_.resize({static_cast<unsigned long>(n_global_elem_)});
@@ -577,32 +1720,35 @@ void CoupledDriver::init_densities()
 
   if (density_ic_ == Initial::neutronics) {
     if (comm_.rank == neutronics_root_) {
-      // Loop over the neutronics cells, then loop over the TH elements
-      // corresponding to that cell and assign the cell density to the correct
-      // index in the densities_ array. This mapping assumes that each TH
-      // element is fully contained within a neutronics cell, i.e., TH elements
-      // are not split between multiple neutronics cells.
-      for (const auto& kv : cell_to_elems_) {
-        CellHandle cell = kv.first;
-        const auto& global_elems = kv.second;
-
-        for (int elem : global_elems) {
-          if (cell_fluid_mask_[cell] == 1) {
-            double rho = neutronics.get_density(cell);
-            densities_[elem] = rho;
-          } else {
-            densities_[elem] = 0.0;
-          }
+      // Loop over the TH elements and assign the density of the corresponding
+      // neutronics cell to the correct index in the densities_ array. This mapping
+      // assumes that each TH element is fully contained within a neutronics cell,
+      // i.e., TH elements are not split between multiple neutronics cells.
+      gsl::index n_elem = elem_to_cell_.size();
+#pragma omp parallel for
+      for (gsl::index elem = 0; elem < n_elem; ++elem) {
+        auto cell = elem_to_cell_[elem];
+        if (cell_fluid_mask_[cell]) {
+          double rho = neutronics.get_density(cell);
+          densities_[elem] = rho;
+        } else {
+          densities_[elem] = 0.0;
         }
       }
     }
     comm_.send_and_recv(densities_, heat_root_, neutronics_root_);
   } else if (density_ic_ == Initial::heat) {
-    // * This sets densities_ on the the coupling_root, based on the
-    //   densities received from the heat solver.
-    // * We do not want to apply underrelaxation here (and at this point,
-    //   there is no previous iterate of density, anyway).
-    update_density(false);
+    // In multi-fidelity mode, the active heat driver only sets the surrogate elements
+    if (surrogate_driver_) {
+      auto rho = heat_fluids_driver_->density();
+      if (comm_.rank == heat_root_) {
+        std::copy(rho.begin(), rho.end(), densities_.begin());
+      }
+    }
+
+    // This sets densities_ on the heat root, based on the densities received from the
+    // heat solver. The neutronics ranks receive them in send_fields().
+    heat.density(active_heat_segment(densities_));
   }
 
   // In both cases, we need to explicitly set densities_prev_
@@ -615,13 +1761,15 @@ void CoupledDriver::init_elem_fluid_mask()
 {
   comm_.message("Initializing element fluid mask");
 
-  const auto& heat = this->get_heat_driver();
-  const auto& neutronics = this->get_neutronics_driver();
-
-  // Get fluid mask and send to all neutronics procs
-  elem_fluid_mask_ = heat.fluid_mask();
-  comm_.send_and_recv(elem_fluid_mask_, neutronics_root_, heat_root_);
-  neutronics.comm_.broadcast(elem_fluid_mask_);
+  // Get fluid mask and send it to all neutronics procs, packed to one bit per element
+  auto fluid_mask = gather_heat_field(&HeatFluidsDriver::fluid_mask);
+  if (comm_.rank == heat_root_) {
+    elem_fluid_mask_ = BitMask{fluid_mask};
+  } else {
+    elem_fluid_mask_ = BitMask(n_global_elem_);
+  }
+  comm_.send_and_recv(elem_fluid_mask_.words(), neutronics_root_, heat_root_);
+  neutronics_broadcast(elem_fluid_mask_.words());
 }
 
 void CoupledDriver::init_cell_fluid_mask()
@@ -631,17 +1779,28 @@ void CoupledDriver::init_cell_fluid_mask()
   // Because init_elem_fluid_mask is *expected* to be called first, it's assumed that
   // all neutron procs will have the correct values for elem_fluid_mask_
   if (this->get_neutronics_driver().active()) {
-    auto n = cell_to_elems_.size();
-    cell_fluid_mask_.resize({n});
-
-    for (const auto& kv : cell_to_elems_) {
-      CellHandle cell = kv.first;
-      for (const auto& elem : kv.second) {
-        if (elem_fluid_mask_[elem] == 1) {
-          cell_fluid_mask_[cell] = 1;
-          break;
+    cell_fluid_mask_ = BitMask(n_cells_);
+
+    // Each thread sets the bits of whole words, so no two threads write the same word
+    int32_t n_words = BitMask::n_words(n_cells_);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int32_t word = 0; word < n_words; ++word) {
+      CellHandle begin = word * BitMask::BITS_PER_WORD;
+      CellHandle end = std::min<CellHandle>(begin + BitMask::BITS_PER_WORD, n_cells_);
+      for (CellHandle cell = begin; cell < end; ++cell) {
+        for (int32_t elem : cell_elems(cell)) {
+          if (elem_fluid_mask_[elem]) {
+            cell_fluid_mask_.set(cell);
+            break;
+          }
         }
-        cell_fluid_mask_[cell] = 0;
+      }
+    }
+
+    fluid_cells_.clear();
+    for (CellHandle cell = 0; cell < n_cells_; ++cell) {
+      if (cell_fluid_mask_[cell]) {
+        fluid_cells_.push_back(cell);
       }
     }
   }
@@ -657,6 +1816,173 @@ void CoupledDriver::init_heat_source()
   }
 }
 
+void CoupledDriver::init_buffers()
+{
+  auto& neutronics = this->get_neutronics_driver();
+
+  if (neutronics.active()) {
+    buffers_.cell_values.assign(n_cells_, 0.0);
+  }
+
+  // Packed element records are assembled on the heat root and unpacked on the
+  // neutronics ranks
+  if (comm_.rank == heat_root_ || neutronics.active()) {
+    buffers_.elem_fields.reserve(n_global_elem_);
+  }
+  if (comm_.rank == heat_root_ && heat_subcycles_ > 1) {
+    buffers_.subcycle_sum.reserve(n_global_elem_);
+  }
+
+  // Packed records are unpacked into the element fields on all neutronics ranks
+  if (neutronics.active()) {
+    auto n = static_cast<std::size_t>(n_global_elem_);
+    if (temperatures_.size() != n) {
+      temperatures_.resize({n});
+    }
+    if (densities_.size() != n) {
+      densities_.resize({n});
+    }
+  }
+
+  // Aitken residuals are kept on the root that relaxes each field
+  if (alpha_ == AITKEN && comm_.rank == neutronics_root_) {
+    aitken_q_.residual = xt::empty<double>({static_cast<std::size_t>(n_cells_)});
+  }
+  if (comm_.rank == heat_root_) {
+    auto n = static_cast<std::size_t>(n_global_elem_);
+    if (alpha_T_ == AITKEN) {
+      aitken_T_.residual = xt::empty<double>({n});
+    }
+    if (alpha_rho_ == AITKEN) {
+      aitken_rho_.residual = xt::empty<double>({n});
+    }
+  }
+}
+
+void CoupledDriver::barrier() const
+{
+  if (communication_ != Communication::partitioned) {
+    comm_.idle_barrier();
+  } else {
+    comm_.Barrier();
+  }
+}
+
+void CoupledDriver::memory_checkpoint(const char* phase) const
+{
+  if (!memory_report_) {
+    return;
+  }
+  report_memory(get_neutronics_driver().comm_, std::string{"neutronics, after "} + phase);
+  report_memory(get_heat_driver().comm_, std::string{"heat-fluids, after "} + phase);
+}
+
+void CoupledDriver::report_data_memory() const
+{
+  if (!memory_report_) {
+    return;
+  }
+
+  comm_.message("Memory held by coupling data structures on all ranks:");
+  report_bytes(comm_, "elem_to_cell_", memory_bytes(elem_to_cell_));
+  report_bytes(comm_,
+               "cell_elems_ (and offsets)",
+               memory_bytes(cell_elems_) + memory_bytes(cell_elem_offsets_));
+  report_bytes(comm_, "elem_volumes_", memory_bytes(elem_volumes_));
+  report_bytes(comm_,
+               "fluid masks",
+               memory_bytes(elem_fluid_mask_) + memory_bytes(cell_fluid_mask_) +
+                 memory_bytes(fluid_cells_));
+  report_bytes(comm_,
+               "temperatures_ (and prev)",
+               memory_bytes(temperatures_) + memory_bytes(temperatures_prev_));
+  report_bytes(comm_,
+               "densities_ (and prev)",
+               memory_bytes(densities_) + memory_bytes(densities_prev_));
+  report_bytes(comm_,
+               "heat_source_ (and prev)",
+               memory_bytes(heat_source_) + memory_bytes(heat_source_prev_) +
+                 memory_bytes(heat_source_std_dev_));
+  report_bytes(comm_,
+               "field history",
+               memory_bytes(temperature_history_) + memory_bytes(density_history_) +
+                 memory_bytes(heat_source_history_));
+  report_bytes(comm_,
+               "exchange buffers",
+               memory_bytes(buffers_.cell_values) + memory_bytes(buffers_.elem_fields));
+
+  const auto& neutronics = get_neutronics_driver();
+  neutronics.comm_.message("Memory held by neutronics driver arrays:");
+  report_bytes(neutronics.comm_, "driver arrays", neutronics.memory_bytes());
+  const auto& heat = get_heat_driver();
+  heat.comm_.message("Memory held by heat-fluids driver arrays:");
+  report_bytes(heat.comm_, "driver arrays", heat.memory_bytes());
+}
+
+void CoupledDriver::write_history()
+{
+  if (!history_) {
+    return;
+  }
+  TraceScope trace{"CoupledDriver::write_history"};
+
+  // The relaxed temperature and density are only up to date for all elements on the
+  // heat root, since the neutronics ranks do not receive the elements of frozen cells.
+  // They are scattered back to the heat ranks, which write their local elements. The
+  // heat ranks hold the whole relaxed heat source and write slabs of it directly.
+  const auto& cell_writers = get_heat_driver().comm_;
+
+  using span = gsl::span<const double>;
+  history_->begin_iteration(i_timestep_, i_picard_);
+  write_history_elem_field("temperature", temperatures_);
+  write_history_elem_field("density", densities_);
+  history_->write_field("heat_source",
+                        span(heat_source_.data(), heat_source_.size()),
+                        n_cells_,
+                        cell_writers);
+  history_->write_scalar("time", time_);
+  history_->write_scalar("temperature_norm", temperature_norm_);
+  history_->write_scalar("density_norm", density_norm_);
+  history_->write_scalar("heat_source_norm", heat_source_norm_);
+  history_->end_iteration();
+}
+
+void CoupledDriver::write_history_elem_field(const char* name,
+                                             const xt::xtensor<double, 1>& field)
+{
+  // In multi-fidelity mode, the surrogate elements follow the high-fidelity elements,
+  // so each heat rank holds one segment of the field for each heat driver
+  std::array<HeatFluidsDriver*, 2> drivers{heat_fluids_driver_.get(),
+                                           surrogate_driver_.get()};
+  std::array<int32_t, 2> offsets{0, n_hifi_elem_};
+  std::vector<FieldHistory::Segment> segments;
+  auto& values = history_values_;
+  std::size_t n = 0;
+  for (int i = 0; i < drivers.size(); ++i) {
+    auto driver = drivers[i];
+    if (!driver || !driver->active()) {
+      continue;
+    }
+    int rank = driver->comm_.rank;
+    int32_t n_local = driver->local_counts_[rank];
+    values.resize(n + n_local);
+    const double* global = comm_.rank == heat_root_ ? field.data() + offsets[i] : nullptr;
+    driver->comm_.Scatterv(global,
+                           driver->local_counts_.data(),
+                           driver->local_displs_.data(),
+                           MPI_DOUBLE,
+                           values.data() + n,
+                           n_local,
+                           MPI_DOUBLE);
+    std::size_t offset = offsets[i] + driver->local_displs_[rank];
+    segments.push_back({offset, static_cast<std::size_t>(n_local)});
+    n += n_local;
+  }
+
+  history_->write_field(
+    name, gsl::span<const double>(values.data(), n), segments, n_global_elem_);
+}
+
 void CoupledDriver::comm_report()
 {
   char c[_POSIX_HOST_NAME_MAX];
@@ -669,6 +1995,11 @@ void CoupledDriver::comm_report()
   int hostw = std::max(8UL, hostname.size()) + 2;
   int rankw = 7;
 
+  // CPUs that this rank may run on and the NUMA domain of the first one
+  auto cpus = cpu_list_string(affinity_cpus());
+  int numa = affinity_domain(Placement::numa);
+  int cpuw = std::max(8UL, cpus.size()) + 2;
+
   for (int i = 0; i < world.size; ++i) {
     if (world.rank == i) {
       if (i == 0) {
@@ -676,13 +2007,17 @@ void CoupledDriver::comm_report()
         std::cout << std::left << std::setw(hostw) << "Hostname" << std::right
                   << std::setw(rankw) << "World" << std::right << std::setw(rankw)
                   << "Coup" << std::right << std::setw(rankw) << "Neut" << std::right
-                  << std::setw(rankw) << "Heat" << std::endl;
+                  << std::setw(rankw) << "Repl" << std::right << std::setw(rankw)
+                  << "Heat" << std::right << std::setw(rankw) << "NUMA" << std::right
+                  << std::setw(cpuw) << "CPUs" << std::endl;
       }
       std::cout << std::left << std::setw(hostw) << hostname << std::right
                 << std::setw(rankw) << world.rank << std::right << std::setw(rankw)
                 << comm_.rank << std::right << std::setw(rankw)
                 << this->get_neutronics_driver().comm_.rank << std::right
-                << std::setw(rankw) << this->get_heat_driver().comm_.rank << std::endl;
+                << std::setw(rankw) << i_replica_ << std::right << std::setw(rankw)
+                << this->get_heat_driver().comm_.rank << std::right << std::setw(rankw)
+                << numa << std::right << std::setw(cpuw) << cpus << std::endl;
     }
     MPI_Barrier(world.comm);
   }
@@ -0,0 +1,166 @@
+#include "enrico/field_history.h"
+
+#include <stdexcept>
+#include <string>
+
+#ifdef USE_PARALLEL_HDF5
+#include <hdf5.h>
+#endif
+
+namespace enrico {
+
+#ifdef USE_PARALLEL_HDF5
+
+static_assert(sizeof(hid_t) == sizeof(std::int64_t),
+              "HDF5 identifiers must be 64-bit integers");
+
+FieldHistory::FieldHistory(const Comm& comm, const std::string& filename)
+{
+  hid_t plist = H5Pcreate(H5P_FILE_ACCESS);
+  H5Pset_fapl_mpio(plist, comm.comm, MPI_INFO_NULL);
+  file_ = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist);
+  H5Pclose(plist);
+  if (file_ < 0) {
+    throw std::runtime_error{"Unable to create field history file " + filename};
+  }
+}
+
+FieldHistory::~FieldHistory()
+{
+  end_iteration();
+  if (file_ >= 0) {
+    H5Fclose(file_);
+  }
+}
+
+void FieldHistory::begin_iteration(int timestep, int iteration)
+{
+  end_iteration();
+
+  // A rejected timestep is repeated with the same index, so the groups of its
+  // earlier attempt are removed when the repeated timestep starts
+  std::string timestep_path = "timestep_" + std::to_string(timestep);
+  if (iteration == 0 && H5Lexists(file_, timestep_path.c_str(), H5P_DEFAULT) > 0) {
+    H5Ldelete(file_, timestep_path.c_str(), H5P_DEFAULT);
+  }
+
+  // Create the timestep group along with the iteration group
+  hid_t lcpl = H5Pcreate(H5P_LINK_CREATE);
+  H5Pset_create_intermediate_group(lcpl, 1);
+  std::string path = timestep_path + "/iteration_" + std::to_string(iteration);
+  group_ = H5Gcreate(file_, path.c_str(), lcpl, H5P_DEFAULT, H5P_DEFAULT);
+  H5Pclose(lcpl);
+  if (group_ < 0) {
+    throw std::runtime_error{"Unable to create group " + path + " in field history"};
+  }
+}
+
+void FieldHistory::write_field(const char* name,
+                               gsl::span<const double> values,
+                               std::size_t global_size,
+                               const Comm& writers)
+{
+  // Each writer takes a contiguous slab of the field; other ranks select nothing
+  std::vector<Segment> segments;
+  if (writers.active()) {
+    std::size_t offset = global_size * writers.rank / writers.size;
+    std::size_t count = global_size * (writers.rank + 1) / writers.size - offset;
+    segments.push_back({offset, count});
+    values = gsl::span<const double>(values.data() + offset, count);
+  }
+  write_field(name, values, segments, global_size);
+}
+
+void FieldHistory::write_field(const char* name,
+                               gsl::span<const double> values,
+                               const std::vector<Segment>& segments,
+                               std::size_t global_size)
+{
+  hsize_t dims = global_size;
+  hid_t filespace = H5Screate_simple(1, &dims, nullptr);
+  hid_t dset = H5Dcreate(
+    group_, name, H5T_NATIVE_DOUBLE, filespace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+
+  // Select the union of this rank's segments, which are contiguous in memory
+  hsize_t count = 0;
+  H5Sselect_none(filespace);
+  for (const auto& segment : segments) {
+    if (segment.size == 0) {
+      continue;
+    }
+    hsize_t offset = segment.offset;
+    hsize_t size = segment.size;
+    H5S_seloper_t op = count == 0 ? H5S_SELECT_SET : H5S_SELECT_OR;
+    H5Sselect_hyperslab(filespace, op, &offset, nullptr, &size, nullptr);
+    count += size;
+  }
+  Expects(count == values.size());
+  hid_t memspace = H5Screate_simple(1, &count, nullptr);
+  if (count == 0) {
+    H5Sselect_none(memspace);
+  }
+
+  hid_t dxpl = H5Pcreate(H5P_DATASET_XFER);
+  H5Pset_dxpl_mpio(dxpl, H5FD_MPIO_COLLECTIVE);
+  const double* buffer = count > 0 ? values.data() : nullptr;
+  herr_t err = H5Dwrite(dset, H5T_NATIVE_DOUBLE, memspace, filespace, dxpl, buffer);
+
+  H5Pclose(dxpl);
+  H5Sclose(memspace);
+  H5Dclose(dset);
+  H5Sclose(filespace);
+  if (err < 0) {
+    throw std::runtime_error{std::string{"Unable to write "} + name +
+                             " to field history"};
+  }
+}
+
+void FieldHistory::write_scalar(const char* name, double value)
+{
+  hid_t space = H5Screate(H5S_SCALAR);
+  hid_t attr =
+    H5Acreate(group_, name, H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, H5P_DEFAULT);
+  H5Awrite(attr, H5T_NATIVE_DOUBLE, &value);
+  H5Aclose(attr);
+  H5Sclose(space);
+}
+
+void FieldHistory::end_iteration()
+{
+  if (group_ >= 0) {
+    H5Gclose(group_);
+    group_ = -1;
+  }
+}
+
+#else
+
+FieldHistory::FieldHistory(const Comm& comm, const std::string& filename)
+{
+  throw std::runtime_error{
+    "A field history requires ENRICO to be built with parallel HDF5"};
+}
+
+FieldHistory::~FieldHistory() {}
+
+void FieldHistory::begin_iteration(int timestep, int iteration) {}
+
+void FieldHistory::write_field(const char* name,
+                               gsl::span<const double> values,
+                               std::size_t global_size,
+                               const Comm& writers)
+{}
+
+void FieldHistory::write_field(const char* name,
+                               gsl::span<const double> values,
+                               const std::vector<Segment>& segments,
+                               std::size_t global_size)
+{}
+
+void FieldHistory::write_scalar(const char* name, double value) {}
+
+void FieldHistory::end_iteration() {}
+
+#endif
+
+} // namespace enrico
@@ -1,5 +1,7 @@
 #include "enrico/heat_fluids_driver.h"
 
+#include "enrico/memory.h"
+
 #include <gsl/gsl>
 #include <pugixml.hpp>
 #include <xtensor/xadapt.hpp>
@@ -13,6 +15,14 @@ HeatFluidsDriver::HeatFluidsDriver(MPI_Comm comm, pugi::xml_node node)
   Expects(pressure_bc_ > 0.0);
 }
 
+std::size_t HeatFluidsDriver::memory_bytes() const
+{
+  return enrico::memory_bytes(local_displs_) + enrico::memory_bytes(local_counts_) +
+         enrico::memory_bytes(local_buffer_) + enrico::memory_bytes(local_fields_) +
+         enrico::memory_bytes(local_centroids_) + enrico::memory_bytes(local_volumes_) +
+         enrico::memory_bytes(local_fluid_mask_);
+}
+
 void HeatFluidsDriver::init_displs()
 {
   if (active()) {
@@ -26,34 +36,70 @@ void HeatFluidsDriver::init_displs()
     for (gsl::index i = 1; i < comm_.size; ++i) {
       local_displs_.at(i) = local_displs_.at(i - 1) + local_counts_.at(i - 1);
     }
+
+    local_buffer_.resize(n_local);
+    local_fields_.resize(n_local);
   }
+  invalidate_geometry();
 }
 
-std::vector<Position> HeatFluidsDriver::centroids() const
+void HeatFluidsDriver::invalidate_geometry()
+{
+  geometry_cached_ = false;
+  local_centroids_ = {};
+  local_volumes_ = {};
+  local_fluid_mask_ = {};
+}
+
+void HeatFluidsDriver::cache_geometry() const
 {
-  // Get local centroids on each rank
-  auto local_centroids = this->centroid_local();
+  // Ranks outside the heat driver have no local elements
+  if (!geometry_cached_ && this->active()) {
+    local_centroids_ = this->centroid_local();
+    local_volumes_ = this->volume_local();
+    local_fluid_mask_ = this->fluid_mask_local();
+    geometry_cached_ = true;
+  }
+}
 
-  // Gather local centroids onto root process
-  return this->gather(local_centroids);
+gsl::span<const Position> HeatFluidsDriver::local_centroids() const
+{
+  cache_geometry();
+  return local_centroids_;
 }
 
-std::vector<double> HeatFluidsDriver::volumes() const
+gsl::span<const double> HeatFluidsDriver::local_volumes() const
+{
+  cache_geometry();
+  return local_volumes_;
+}
+
+gsl::span<const int> HeatFluidsDriver::local_fluid_mask() const
+{
+  cache_geometry();
+  return local_fluid_mask_;
+}
+
+std::vector<Position> HeatFluidsDriver::centroids() const
 {
-  // Get local volumes on each rank
-  auto local_volumes = this->volume_local();
+  // Gather the cached local centroids onto root process
+  return this->gather(this->local_centroids());
+}
 
-  // Gather local centroids onto root process
-  return this->gather(local_volumes);
+std::vector<double> HeatFluidsDriver::volumes() const
+{
+  // Gather the cached local volumes onto root process
+  return this->gather(this->local_volumes());
 }
 
 xt::xtensor<double, 1> HeatFluidsDriver::temperature() const
 {
   // Get local tempratures on each rank
-  auto local_temperatures = this->temperature_local();
+  std::vector<double> local_temperatures(this->n_local_elem());
+  this->temperature_local(local_temperatures);
 
   // Gather all the local element temperatures onto the root
-  auto global_temperatures = this->gather(local_temperatures);
+  auto global_temperatures = this->gather(gsl::span<const double>(local_temperatures));
 
   // only the return value from root should be used, or else a broadcast added here
   return xt::adapt(global_temperatures);
@@ -62,21 +108,43 @@ xt::xtensor<double, 1> HeatFluidsDriver::temperature() const
 xt::xtensor<double, 1> HeatFluidsDriver::density() const
 {
   // Get local densities on each rank
-  auto local_densities = this->density_local();
+  std::vector<double> local_densities(this->n_local_elem());
+  this->density_local(local_densities);
 
   // Gather all local element densities onto the root
-  auto global_densities = this->gather(local_densities);
+  auto global_densities = this->gather(gsl::span<const double>(local_densities));
 
   return xt::adapt(global_densities);
 }
 
-std::vector<int> HeatFluidsDriver::fluid_mask() const
+void HeatFluidsDriver::temperature(gsl::span<double> global)
+{
+  if (this->active()) {
+    this->temperature_local(local_buffer_);
+    this->gather(gsl::span<const double>(local_buffer_), global);
+  }
+}
+
+void HeatFluidsDriver::density(gsl::span<double> global)
 {
-  // Get local fluid masks
-  auto local_fluid_mask = this->fluid_mask_local();
+  if (this->active()) {
+    this->density_local(local_buffer_);
+    this->gather(gsl::span<const double>(local_buffer_), global);
+  }
+}
 
-  // Gather all the local fluid masks onto the root
-  return this->gather(local_fluid_mask);
+void HeatFluidsDriver::fields(gsl::span<ElementFields> global)
+{
+  if (this->active()) {
+    this->fields_local(local_fields_);
+    this->gather(gsl::span<const ElementFields>(local_fields_), global);
+  }
+}
+
+std::vector<int> HeatFluidsDriver::fluid_mask() const
+{
+  // Gather the cached local fluid masks onto the root
+  return this->gather(this->local_fluid_mask());
 }
 
 }
@@ -0,0 +1,80 @@
+#include "enrico/memory.h"
+
+#include <cstdio> // for snprintf
+#include <fstream>
+#include <sstream>
+
+namespace enrico {
+
+MemoryUsage memory_usage()
+{
+  MemoryUsage usage;
+
+  // Lines of /proc/self/status look like "VmRSS:   123456 kB"
+  std::ifstream status{"/proc/self/status"};
+  std::string line;
+  while (std::getline(status, line)) {
+    std::istringstream fields{line};
+    std::string key;
+    double kib;
+    if (!(fields >> key >> kib)) {
+      continue;
+    }
+    if (key == "VmRSS:") {
+      usage.rss = kib / 1024.0;
+    } else if (key == "VmHWM:") {
+      usage.hwm = kib / 1024.0;
+    }
+  }
+  return usage;
+}
+
+void report_memory(const Comm& comm, const std::string& label)
+{
+  if (!comm.active()) {
+    return;
+  }
+
+  auto usage = memory_usage();
+  double local[] = {usage.rss, usage.hwm};
+  double max[2];
+  double total[2];
+  MPI_Reduce(local, max, 2, MPI_DOUBLE, MPI_MAX, 0, comm.comm);
+  MPI_Reduce(local, total, 2, MPI_DOUBLE, MPI_SUM, 0, comm.comm);
+
+  char msg[256];
+  std::snprintf(msg,
+                sizeof(msg),
+                "Memory (%s): RSS max %.1f MiB, total %.1f MiB; "
+                "HWM max %.1f MiB, total %.1f MiB",
+                label.c_str(),
+                max[0],
+                total[0],
+                max[1],
+                total[1]);
+  comm.message(msg);
+}
+
+void report_bytes(const Comm& comm, const std::string& name, std::size_t bytes)
+{
+  if (!comm.active()) {
+    return;
+  }
+
+  double local = bytes / (1024.0 * 1024.0);
+  double max;
+  double total;
+  MPI_Reduce(&local, &max, 1, MPI_DOUBLE, MPI_MAX, 0, comm.comm);
+  MPI_Reduce(&local, &total, 1, MPI_DOUBLE, MPI_SUM, 0, comm.comm);
+
+  char msg[256];
+  std::snprintf(msg,
+                sizeof(msg),
+                "  %-28s max %10.3f MiB, total %10.3f MiB",
+                name.c_str(),
+                max,
+                total);
+  comm.message(msg);
+}
+
+} // namespace enrico
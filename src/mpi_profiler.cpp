@@ -0,0 +1,591 @@
+//! \file mpi_profiler.cpp
+//! PMPI interposition library that profiles the MPI calls made by ENRICO and the
+//! physics libraries it drives.
+//!
+//! The library defines the MPI functions used during coupled runs, times each call
+//! and forwards it to the PMPI entry point. Statistics are kept per function, call
+//! site, and communicator, which is identified by its size and the world rank of its
+//! rank 0. Nonblocking barriers are timed from MPI_Ibarrier until MPI_Test finds them
+//! complete, all of which is reported as wait time. When MPI_Finalize is called, each
+//! rank writes a summary to mpiprof_rank<N>.txt and world rank 0 writes a summary over
+//! all ranks to mpiprof_summary.txt.
+//!
+//! It is used by preloading it, e.g.,
+//!
+//!   mpirun -np 32 -x LD_PRELOAD=/path/to/libenrico_mpiprof.so enrico
+//!
+//! If the environment variable ENRICO_MPIPROF_WAIT is set, each collective call is
+//! preceded by a barrier on the same communicator. The time spent in that barrier is
+//! reported as wait time, which is the load imbalance between the ranks, and the
+//! remainder of the call is the time spent communicating. Without it, the wait time is
+//! only known for barriers.
+
+#include <mpi.h>
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+//! Identifies the calls that statistics are collected for
+struct CallKey {
+  const char* function;    //!< Name of the MPI function
+  void* site;              //!< Return address of the call
+  const std::string* comm; //!< Label of the communicator of the call
+
+  bool operator<(const CallKey& other) const
+  {
+    return std::tie(function, site, comm) <
+           std::tie(other.function, other.site, other.comm);
+  }
+};
+
+//! Statistics of one kind of call on the calling rank
+struct CallStats {
+  long count{0};     //!< Number of calls
+  double bytes{0.0}; //!< Bytes sent (or received, for MPI_Recv)
+  double time{0.0};  //!< Total time in [s], including wait time
+  double wait{0.0};  //!< Time in [s] spent waiting for other ranks
+};
+
+//! Statistics of one kind of call, combined over ranks
+struct SummaryStats {
+  long count{0};        //!< Number of calls on all ranks
+  int n_ranks{0};       //!< Number of ranks making the call
+  double bytes{0.0};    //!< Bytes on all ranks
+  double time{0.0};     //!< Total time in [s] on all ranks
+  double max_time{0.0}; //!< Largest time in [s] on one rank
+  double wait{0.0};     //!< Total wait time in [s] on all ranks
+};
+
+//! A nonblocking barrier that has not been found complete yet
+struct PendingBarrier {
+  void* site;    //!< Return address of the MPI_Ibarrier call
+  MPI_Comm comm; //!< Communicator of the barrier
+  double start;  //!< Time at which the barrier was started in [s]
+};
+
+std::map<CallKey, CallStats> stats;
+
+//! Labels of all communicators seen. Statistics refer to the labels rather than the
+//! communicator handles, since handles are reused once a communicator is freed.
+std::set<std::string> labels;
+
+//! Label of each communicator handle currently in use
+std::unordered_map<MPI_Comm, const std::string*> comm_labels;
+
+//! Nonblocking barriers by request handle
+std::map<MPI_Request, PendingBarrier> pending_barriers;
+
+std::mutex stats_mutex;
+
+//! Whether collectives are preceded by a barrier to measure wait time
+bool measure_wait()
+{
+  static const bool wait = std::getenv("ENRICO_MPIPROF_WAIT") != nullptr;
+  return wait;
+}
+
+//! Describe a communicator by its size and the world rank of its rank 0
+std::string comm_label(MPI_Comm comm)
+{
+  if (comm == MPI_COMM_NULL) {
+    return "none";
+  }
+
+  int result;
+  PMPI_Comm_compare(comm, MPI_COMM_WORLD, &result);
+  if (result == MPI_IDENT || result == MPI_CONGRUENT) {
+    return "world";
+  }
+
+  int size;
+  PMPI_Comm_size(comm, &size);
+  MPI_Group group, world_group;
+  PMPI_Comm_group(comm, &group);
+  PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+  int root = 0;
+  int world_root;
+  PMPI_Group_translate_ranks(group, 1, &root, world_group, &world_root);
+  PMPI_Group_free(&group);
+  PMPI_Group_free(&world_group);
+  return "size " + std::to_string(size) + ", root " + std::to_string(world_root);
+}
+
+//! Bytes in a buffer of MPI datatypes
+double buffer_bytes(int count, MPI_Datatype datatype)
+{
+  int size = 0;
+  if (datatype != MPI_DATATYPE_NULL) {
+    PMPI_Type_size(datatype, &size);
+  }
+  return static_cast<double>(count) * size;
+}
+
+//! Wait for the other ranks of a collective if wait time is being measured
+//! \return Time in [s] spent waiting
+double collective_wait(MPI_Comm comm)
+{
+  if (!measure_wait()) {
+    return 0.0;
+  }
+  double start = PMPI_Wtime();
+  PMPI_Barrier(comm);
+  return PMPI_Wtime() - start;
+}
+
+//! Add a call to the statistics
+void record(const char* function,
+            void* site,
+            MPI_Comm comm,
+            double bytes,
+            double time,
+            double wait)
+{
+  std::lock_guard<std::mutex> lock{stats_mutex};
+  auto it = comm_labels.find(comm);
+  if (it == comm_labels.end()) {
+    const std::string* label = &*labels.insert(comm_label(comm)).first;
+    it = comm_labels.emplace(comm, label).first;
+  }
+  auto& s = stats[{function, site, it->second}];
+  ++s.count;
+  s.bytes += bytes;
+  s.time += time + wait;
+  s.wait += wait;
+}
+
+//! Describe a call site by its function and offset, or its module and offset
+std::string site_name(void* site)
+{
+  Dl_info info;
+  char buffer[512];
+  if (dladdr(site, &info) && info.dli_sname) {
+    auto offset = reinterpret_cast<std::uintptr_t>(site) -
+                  reinterpret_cast<std::uintptr_t>(info.dli_saddr);
+    std::snprintf(buffer, sizeof(buffer), "%s+0x%zx", info.dli_sname, offset);
+  } else if (dladdr(site, &info) && info.dli_fname) {
+    // Offsets relative to the module are the same on all ranks, even with ASLR
+    auto offset = reinterpret_cast<std::uintptr_t>(site) -
+                  reinterpret_cast<std::uintptr_t>(info.dli_fbase);
+    std::string module{info.dli_fname};
+    module = module.substr(module.find_last_of('/') + 1);
+    std::snprintf(buffer, sizeof(buffer), "%s+0x%zx", module.c_str(), offset);
+  } else {
+    std::snprintf(buffer, sizeof(buffer), "%p", site);
+  }
+  return buffer;
+}
+
+//! Write a table of statistics, sorted by decreasing time
+void write_table(std::ostream& out,
+                 const std::vector<std::pair<std::string, SummaryStats>>& rows,
+                 bool summary)
+{
+  char line[1024];
+  std::snprintf(line,
+                sizeof(line),
+                "%-16s %10s %12s %11s %11s %11s %11s %s\n",
+                "function",
+                "calls",
+                "bytes/call",
+                "time [s]",
+                summary ? "max [s]" : "",
+                "wait [s]",
+                "MB/s",
+                "communicator | call site");
+  out << line;
+  for (const auto& row : rows) {
+    const auto& s = row.second;
+    auto sep = row.first.find('|');
+    // Bandwidth is computed from the time not spent waiting
+    double transfer = s.time - s.wait;
+    double bandwidth = transfer > 0.0 ? s.bytes / transfer / 1.0e6 : 0.0;
+    char max_time[16] = "";
+    if (summary) {
+      std::snprintf(max_time, sizeof(max_time), "%11.4f", s.max_time);
+    }
+    std::snprintf(line,
+                  sizeof(line),
+                  "%-16s %10ld %12.0f %11.4f %11s %11.4f %11.1f %s\n",
+                  row.first.substr(0, sep).c_str(),
+                  s.count,
+                  s.count > 0 ? s.bytes / s.count : 0.0,
+                  s.time,
+                  max_time,
+                  s.wait,
+                  bandwidth,
+                  row.first.substr(sep + 1).c_str());
+    out << line;
+  }
+}
+
+//! Sort rows of statistics by decreasing time
+std::vector<std::pair<std::string, SummaryStats>>
+sorted_rows(const std::map<std::string, SummaryStats>& rows)
+{
+  std::vector<std::pair<std::string, SummaryStats>> sorted(rows.begin(), rows.end());
+  std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+    return a.second.time > b.second.time;
+  });
+  return sorted;
+}
+
+//! Write the per-rank and global summaries
+void write_reports()
+{
+  int rank, size;
+  PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  PMPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  // Combine the calls of this rank by function, communicator, and call site name.
+  // Keys are "function|communicator | site".
+  std::map<std::string, SummaryStats> local;
+  for (const auto& kv : stats) {
+    std::string key = std::string{kv.first.function} + "|" +
+                      *kv.first.comm + " | " + site_name(kv.first.site);
+    auto& s = local[key];
+    s.count += kv.second.count;
+    s.n_ranks = 1;
+    s.bytes += kv.second.bytes;
+    s.time += kv.second.time;
+    s.max_time = s.time;
+    s.wait += kv.second.wait;
+  }
+
+  {
+    std::ofstream out{"mpiprof_rank" + std::to_string(rank) + ".txt"};
+    out << "MPI profile of world rank " << rank << "\n\n";
+    write_table(out, sorted_rows(local), false);
+  }
+
+  // Serialize the rows of this rank, one per line, and gather them on rank 0
+  std::ostringstream lines;
+  lines.precision(17);
+  for (const auto& kv : local) {
+    lines << kv.first << '\t' << kv.second.count << '\t' << kv.second.bytes << '\t'
+          << kv.second.time << '\t' << kv.second.wait << '\n';
+  }
+  std::string text = lines.str();
+  int n = text.size();
+  std::vector<int> counts(size);
+  PMPI_Gather(&n, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+  std::vector<int> displs(size, 0);
+  for (int i = 1; i < size; ++i) {
+    displs[i] = displs[i - 1] + counts[i - 1];
+  }
+  std::string all_text;
+  if (rank == 0) {
+    all_text.resize(displs.back() + counts.back());
+  }
+  PMPI_Gatherv(&text[0],
+               n,
+               MPI_CHAR,
+               &all_text[0],
+               counts.data(),
+               displs.data(),
+               MPI_CHAR,
+               0,
+               MPI_COMM_WORLD);
+  if (rank != 0) {
+    return;
+  }
+
+  std::map<std::string, SummaryStats> global;
+  std::istringstream in{all_text};
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields{line};
+    std::string key;
+    CallStats c;
+    std::getline(fields, key, '\t');
+    fields >> c.count >> c.bytes >> c.time >> c.wait;
+    auto& s = global[key];
+    s.count += c.count;
+    s.n_ranks += 1;
+    s.bytes += c.bytes;
+    s.time += c.time;
+    s.max_time = std::max(s.max_time, c.time);
+    s.wait += c.wait;
+  }
+
+  std::ofstream out{"mpiprof_summary.txt"};
+  out << "MPI profile summed over " << size << " ranks. A max time much larger than "
+      << "the mean time\n(time / ranks) indicates load imbalance; a low MB/s with "
+      << "small bytes/call\nindicates latency-bound communication.\n\n";
+  write_table(out, sorted_rows(global), true);
+}
+
+} // namespace
+
+extern "C" {
+
+int MPI_Barrier(MPI_Comm comm)
+{
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Barrier(comm);
+  double time = PMPI_Wtime() - start;
+  // All of the time in a barrier is spent waiting for other ranks
+  record("MPI_Barrier", __builtin_return_address(0), comm, 0.0, 0.0, time);
+  return ierr;
+}
+
+int MPI_Bcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm)
+{
+  double wait = collective_wait(comm);
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Bcast(buffer, count, datatype, root, comm);
+  double time = PMPI_Wtime() - start;
+  record("MPI_Bcast",
+         __builtin_return_address(0),
+         comm,
+         buffer_bytes(count, datatype),
+         time,
+         wait);
+  return ierr;
+}
+
+int MPI_Reduce(const void* sendbuf,
+               void* recvbuf,
+               int count,
+               MPI_Datatype datatype,
+               MPI_Op op,
+               int root,
+               MPI_Comm comm)
+{
+  double wait = collective_wait(comm);
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+  double time = PMPI_Wtime() - start;
+  record("MPI_Reduce",
+         __builtin_return_address(0),
+         comm,
+         buffer_bytes(count, datatype),
+         time,
+         wait);
+  return ierr;
+}
+
+int MPI_Allreduce(const void* sendbuf,
+                  void* recvbuf,
+                  int count,
+                  MPI_Datatype datatype,
+                  MPI_Op op,
+                  MPI_Comm comm)
+{
+  double wait = collective_wait(comm);
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+  double time = PMPI_Wtime() - start;
+  record("MPI_Allreduce",
+         __builtin_return_address(0),
+         comm,
+         buffer_bytes(count, datatype),
+         time,
+         wait);
+  return ierr;
+}
+
+int MPI_Gather(const void* sendbuf,
+               int sendcount,
+               MPI_Datatype sendtype,
+               void* recvbuf,
+               int recvcount,
+               MPI_Datatype recvtype,
+               int root,
+               MPI_Comm comm)
+{
+  double wait = collective_wait(comm);
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Gather(
+    sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+  double time = PMPI_Wtime() - start;
+  record("MPI_Gather",
+         __builtin_return_address(0),
+         comm,
+         buffer_bytes(sendcount, sendtype),
+         time,
+         wait);
+  return ierr;
+}
+
+int MPI_Gatherv(const void* sendbuf,
+                int sendcount,
+                MPI_Datatype sendtype,
+                void* recvbuf,
+                const int recvcounts[],
+                const int displs[],
+                MPI_Datatype recvtype,
+                int root,
+                MPI_Comm comm)
+{
+  double wait = collective_wait(comm);
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Gatherv(
+    sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+  double time = PMPI_Wtime() - start;
+  record("MPI_Gatherv",
+         __builtin_return_address(0),
+         comm,
+         buffer_bytes(sendcount, sendtype),
+         time,
+         wait);
+  return ierr;
+}
+
+int MPI_Scatterv(const void* sendbuf,
+                 const int sendcounts[],
+                 const int displs[],
+                 MPI_Datatype sendtype,
+                 void* recvbuf,
+                 int recvcount,
+                 MPI_Datatype recvtype,
+                 int root,
+                 MPI_Comm comm)
+{
+  double wait = collective_wait(comm);
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Scatterv(
+    sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+  double time = PMPI_Wtime() - start;
+  record("MPI_Scatterv",
+         __builtin_return_address(0),
+         comm,
+         buffer_bytes(recvcount, recvtype),
+         time,
+         wait);
+  return ierr;
+}
+
+int MPI_Allgather(const void* sendbuf,
+                  int sendcount,
+                  MPI_Datatype sendtype,
+                  void* recvbuf,
+                  int recvcount,
+                  MPI_Datatype recvtype,
+                  MPI_Comm comm)
+{
+  double wait = collective_wait(comm);
+  double start = PMPI_Wtime();
+  int ierr =
+    PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+  double time = PMPI_Wtime() - start;
+  record("MPI_Allgather",
+         __builtin_return_address(0),
+         comm,
+         buffer_bytes(sendcount, sendtype),
+         time,
+         wait);
+  return ierr;
+}
+
+int MPI_Send(
+  const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm)
+{
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Send(buf, count, datatype, dest, tag, comm);
+  double time = PMPI_Wtime() - start;
+  record("MPI_Send",
+         __builtin_return_address(0),
+         comm,
+         buffer_bytes(count, datatype),
+         time,
+         0.0);
+  return ierr;
+}
+
+int MPI_Recv(void* buf,
+             int count,
+             MPI_Datatype datatype,
+             int source,
+             int tag,
+             MPI_Comm comm,
+             MPI_Status* status)
+{
+  // The actual count is taken from the status, so make sure there is one
+  MPI_Status local_status;
+  if (status == MPI_STATUS_IGNORE) {
+    status = &local_status;
+  }
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+  double time = PMPI_Wtime() - start;
+  int received = 0;
+  PMPI_Get_count(status, datatype, &received);
+  record("MPI_Recv",
+         __builtin_return_address(0),
+         comm,
+         buffer_bytes(received, datatype),
+         time,
+         0.0);
+  return ierr;
+}
+
+int MPI_Ibarrier(MPI_Comm comm, MPI_Request* request)
+{
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Ibarrier(comm, request);
+  if (ierr == MPI_SUCCESS) {
+    std::lock_guard<std::mutex> lock{stats_mutex};
+    pending_barriers[*request] = {__builtin_return_address(0), comm, start};
+  }
+  return ierr;
+}
+
+int MPI_Test(MPI_Request* request, int* flag, MPI_Status* status)
+{
+  // The handle is reset to MPI_REQUEST_NULL when the request completes
+  MPI_Request handle = *request;
+  double start = PMPI_Wtime();
+  int ierr = PMPI_Test(request, flag, status);
+  double end = PMPI_Wtime();
+
+  PendingBarrier barrier{nullptr, MPI_COMM_NULL, 0.0};
+  {
+    std::lock_guard<std::mutex> lock{stats_mutex};
+    auto it = pending_barriers.find(handle);
+    if (it != pending_barriers.end()) {
+      barrier = it->second;
+      if (*flag) {
+        pending_barriers.erase(it);
+      }
+    }
+  }
+  record("MPI_Test", __builtin_return_address(0), barrier.comm, 0.0, end - start, 0.0);
+  if (barrier.site && *flag) {
+    // All of the time until a barrier completes is spent waiting for other ranks
+    record("MPI_Ibarrier", barrier.site, barrier.comm, 0.0, 0.0, end - barrier.start);
+  }
+  return ierr;
+}
+
+int MPI_Comm_free(MPI_Comm* comm)
+{
+  // The handle may be reused for a different communicator once this one is freed
+  {
+    std::lock_guard<std::mutex> lock{stats_mutex};
+    comm_labels.erase(*comm);
+  }
+  return PMPI_Comm_free(comm);
+}
+
+int MPI_Finalize()
+{
+  write_reports();
+  return PMPI_Finalize();
+}
+
+} // extern "C"
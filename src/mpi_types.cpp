@@ -1,5 +1,6 @@
 #include "enrico/mpi_types.h"
 
+#include "enrico/element_fields.h"
 #include "enrico/geom.h"
 
 #include <mpi.h>
@@ -11,6 +12,7 @@ namespace enrico {
 //==============================================================================
 
 MPI_Datatype position_mpi_datatype{MPI_DATATYPE_NULL};
+MPI_Datatype element_fields_mpi_datatype{MPI_DATATYPE_NULL};
 
 //==============================================================================
 // Functions
@@ -36,11 +38,28 @@ void init_mpi_datatypes()
   // Make datatype
   MPI_Type_create_struct(3, blockcounts, displs, types, &position_mpi_datatype);
   MPI_Type_commit(&position_mpi_datatype);
+
+  // Make datatype for the fields of an element in the same way
+  ElementFields f;
+  int field_blockcounts[2] = {1, 1};
+  MPI_Datatype field_types[2] = {MPI_DOUBLE, MPI_DOUBLE};
+  MPI_Aint field_displs[2];
+
+  MPI_Get_address(&f.temperature, &field_displs[0]);
+  MPI_Get_address(&f.density, &field_displs[1]);
+
+  field_displs[1] -= field_displs[0];
+  field_displs[0] = 0;
+
+  MPI_Type_create_struct(
+    2, field_blockcounts, field_displs, field_types, &element_fields_mpi_datatype);
+  MPI_Type_commit(&element_fields_mpi_datatype);
 }
 
 void free_mpi_datatypes()
 {
   MPI_Type_free(&position_mpi_datatype);
+  MPI_Type_free(&element_fields_mpi_datatype);
 }
 
 // Traits for mapping plain types to corresponding MPI types (ints)
@@ -70,6 +89,11 @@ MPI_Datatype get_mpi_type<long long>()
   return MPI_LONG_LONG;
 }
 template<>
+MPI_Datatype get_mpi_type<unsigned short>()
+{
+  return MPI_UNSIGNED_SHORT;
+}
+template<>
 MPI_Datatype get_mpi_type<unsigned int>()
 {
   return MPI_UNSIGNED;
@@ -109,5 +133,10 @@ MPI_Datatype get_mpi_type<Position>()
 {
   return position_mpi_datatype;
 }
+template<>
+MPI_Datatype get_mpi_type<ElementFields>()
+{
+  return element_fields_mpi_datatype;
+}
 
 } // namespace enrico
@@ -45,15 +45,13 @@ void Nek5000Driver::init_session_name()
   session_name.close();
 }
 
-std::vector<double> Nek5000Driver::temperature_local() const
+void Nek5000Driver::temperature_local(gsl::span<double> local) const
 {
   // Each Nek proc finds the temperatures of its local elements
-  std::vector<double> local_elem_temperatures(nelt_);
+  Expects(local.size() == nelt_);
   for (int32_t i = 0; i < nelt_; ++i) {
-    local_elem_temperatures[i] = this->temperature_at(i);
+    local[i] = this->temperature_at(i);
   }
-
-  return local_elem_temperatures;
 }
 
 std::vector<int> Nek5000Driver::fluid_mask_local() const
@@ -65,21 +63,33 @@ std::vector<int> Nek5000Driver::fluid_mask_local() const
   return local_fluid_mask;
 }
 
-std::vector<double> Nek5000Driver::density_local() const
+void Nek5000Driver::density_local(gsl::span<double> local) const
 {
-  std::vector<double> local_densities(nelt_);
+  Expects(local.size() == nelt_);
 
   for (int32_t i = 0; i < nelt_; ++i) {
     if (this->in_fluid_at(i) == 1) {
       auto T = this->temperature_at(i);
       // nu1 returns specific volume in [m^3/kg]
-      local_densities[i] = 1.0e-3 / iapws::nu1(pressure_bc_, T);
+      local[i] = 1.0e-3 / iapws::nu1(pressure_bc_, T);
     } else {
-      local_densities[i] = 0.0;
+      local[i] = 0.0;
     }
   }
+}
+
+void Nek5000Driver::fields_local(gsl::span<ElementFields> local) const
+{
+  Expects(local.size() == nelt_);
 
-  return local_densities;
+  // The temperature of each element is computed once and also used for its density
+  for (int32_t i = 0; i < nelt_; ++i) {
+    double T = this->temperature_at(i);
+    local[i].temperature = T;
+    // nu1 returns specific volume in [m^3/kg]
+    local[i].density =
+      this->in_fluid_at(i) == 1 ? 1.0e-3 / iapws::nu1(pressure_bc_, T) : 0.0;
+  }
 }
 
 void Nek5000Driver::solve_step()
@@ -6,6 +6,7 @@
 #include "nekrs.hpp"
 
 #include <algorithm>
+#include <cmath> // for abs, round
 #include <dlfcn.h>
 
 namespace enrico {
@@ -67,12 +68,16 @@ void NekRSDriver::init_step()
 
 void NekRSDriver::solve_step()
 {
-  const auto start_time = nekrs::startTime();
-  const auto final_time = nekrs::finalTime();
   const auto dt = nekrs::dt();
 
-  time_ = start_time;
-  tstep_ = 1;
+  // Without a coupled timestep, every solve replays the time window of the .par file
+  // from the initial condition
+  auto final_time = step_end_;
+  if (!continuous_time_) {
+    time_ = nekrs::startTime();
+    tstep_ = 1;
+    final_time = nekrs::finalTime();
+  }
 
   while ((final_time - time_) / (final_time * dt) > 1e-6) {
     nekrs::runStep(time_, dt, tstep_);
@@ -83,6 +88,20 @@ void NekRSDriver::solve_step()
   nekrs::copyToNek(time_, tstep_);
 }
 
+void NekRSDriver::set_timestep(double time, double dt)
+{
+  // The coupled timestep must be made of whole NekRS steps so that the clocks agree
+  double n_steps = std::round(dt / nekrs::dt());
+  err_chk(n_steps >= 1.0 && std::abs(n_steps * nekrs::dt() - dt) <= 1.0e-6 * dt,
+          "Coupled timestep must be a multiple of the NekRS timestep");
+
+  // The coupled clock starts at zero, whereas the NekRS clock starts at the start time
+  // of the .par file
+  continuous_time_ = true;
+  time_ = nekrs::startTime() + time;
+  step_end_ = time_ + dt;
+}
+
 void NekRSDriver::write_step(int timestep, int iteration)
 {
   nekrs::copyToNek(timestep, iteration);
@@ -150,32 +169,43 @@ double NekRSDriver::temperature_at(int32_t local_elem) const
   return sum0 / sum1;
 }
 
-std::vector<double> NekRSDriver::temperature_local() const
+void NekRSDriver::temperature_local(gsl::span<double> local) const
 {
-  std::vector<double> t(n_local_elem());
+  Expects(local.size() == n_local_elem());
   for (int32_t i = 0; i < n_local_elem(); ++i) {
-    t[i] = this->temperature_at(i);
+    local[i] = this->temperature_at(i);
   }
-
-  return t;
 }
 
-std::vector<double> NekRSDriver::density_local() const
+void NekRSDriver::density_local(gsl::span<double> local) const
 {
   nekrs::copyToNek(time_, tstep_);
-  std::vector<double> local_densities(n_local_elem());
+  Expects(local.size() == n_local_elem());
 
   for (int32_t i = 0; i < n_local_elem(); ++i) {
     if (this->in_fluid_at(i) == 1) {
       auto T = this->temperature_at(i);
       // nu1 returns specific volume in [m^3/kg]
-      local_densities[i] = 1.0e-3 / iapws::nu1(pressure_bc_, T);
+      local[i] = 1.0e-3 / iapws::nu1(pressure_bc_, T);
     } else {
-      local_densities[i] = 0.0;
+      local[i] = 0.0;
     }
   }
+}
 
-  return local_densities;
+void NekRSDriver::fields_local(gsl::span<ElementFields> local) const
+{
+  nekrs::copyToNek(time_, tstep_);
+  Expects(local.size() == n_local_elem());
+
+  // The temperature of each element is computed once and also used for its density
+  for (int32_t i = 0; i < n_local_elem(); ++i) {
+    double T = this->temperature_at(i);
+    local[i].temperature = T;
+    // nu1 returns specific volume in [m^3/kg]
+    local[i].density =
+      this->in_fluid_at(i) == 1 ? 1.0e-3 / iapws::nu1(pressure_bc_, T) : 0.0;
+  }
 }
 
 int NekRSDriver::in_fluid_at(int32_t local_elem) const
@@ -6,16 +6,22 @@
 #include "openmc/capi.h"
 #include "openmc/cell.h"
 #include "openmc/constants.h"
+#include "openmc/settings.h"
 #include "openmc/tallies/filter.h"
 #include "openmc/tallies/filter_material.h"
 #include "openmc/tallies/tally.h"
 #include "xtensor/xadapt.hpp"
 #include "xtensor/xarray.hpp"
+#include "xtensor/xbuilder.hpp"
 #include "xtensor/xview.hpp"
 #include <gsl/gsl>
 
+#include <algorithm> // for fill, max
+#include <cmath>     // for sqrt
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <utility> // for move
 
 namespace enrico {
 
@@ -79,21 +85,30 @@ void OpenmcDriver::create_tallies()
 
 xt::xtensor<double, 1> OpenmcDriver::heat_source(double power) const
 {
-  // Determine number of realizations for normalizing tallies
-  int m = tally_->n_realizations_;
+  xt::xtensor<double, 1> heat;
+  this->heat_source(power, heat);
+  return heat;
+}
 
-  // Broadcast number of realizations
-  // TODO: Change OpenMC so that it's correct on all ranks
-  comm_.broadcast(m);
+void OpenmcDriver::heat_source(double power, xt::xtensor<double, 1>& heat) const
+{
+  // Determine number of realizations for normalizing tallies
+  int m = this->n_realizations();
 
   // Determine energy production in each material. Note that xt::view doesn't
   // work with enum
   int i_sum = static_cast<int>(openmc::TallyResult::SUM);
   auto mean_value = xt::view(tally_->results_, xt::all(), 0, i_sum);
-  xt::xtensor<double, 1> heat = JOULE_PER_EV * mean_value / m;
+  if (heat.size() != mean_value.size()) {
+    heat.resize({mean_value.size()});
+  }
 
   // Get total heat production [J/source]
-  double total_heat = xt::sum(heat)();
+  double total_heat = 0.0;
+  for (gsl::index i = 0; i < heat.size(); ++i) {
+    heat(i) = JOULE_PER_EV * mean_value(i) / m;
+    total_heat += heat(i);
+  }
 
   for (gsl::index i = 0; i < heat.size(); ++i) {
     // Get volume
@@ -104,20 +119,91 @@ xt::xtensor<double, 1> OpenmcDriver::heat_source(double power) const
     // gives an absolute value in W.
     heat(i) *= power / (total_heat * V);
   }
+}
 
-  return heat;
+xt::xtensor<double, 1> OpenmcDriver::heat_source_std_dev(double power) const
+{
+  xt::xtensor<double, 1> std_dev;
+  this->heat_source_std_dev(power, std_dev);
+  return std_dev;
+}
+
+void OpenmcDriver::heat_source_std_dev(double power,
+                                       xt::xtensor<double, 1>& std_dev) const
+{
+  int m = this->n_realizations();
+
+  int i_sum = static_cast<int>(openmc::TallyResult::SUM);
+  int i_sum_sq = static_cast<int>(openmc::TallyResult::SUM_SQ);
+  auto sum = xt::view(tally_->results_, xt::all(), 0, i_sum);
+  auto sum_sq = xt::view(tally_->results_, xt::all(), 0, i_sum_sq);
+
+  // Get total heat production [J/source], as used to normalize the heat source. Its
+  // own uncertainty is neglected.
+  double total_heat = 0.0;
+  for (gsl::index i = 0; i < sum.size(); ++i) {
+    total_heat += sum(i);
+  }
+  total_heat *= JOULE_PER_EV / m;
+
+  if (std_dev.size() != sum.size()) {
+    std_dev.resize({sum.size()});
+  }
+  std::fill(std_dev.begin(), std_dev.end(), 0.0);
+  if (m > 1) {
+    for (gsl::index i = 0; i < std_dev.size(); ++i) {
+      // Standard deviation of the mean energy production [eV/source]
+      double mean = sum(i) / m;
+      double variance = (sum_sq(i) / m - mean * mean) / (m - 1);
+      double s = std::sqrt(std::max(variance, 0.0));
+
+      // Convert to [W/cm^3] in the same way as the heat source
+      double V = cells_.at(i).volume_;
+      std_dev(i) = JOULE_PER_EV * s * power / (total_heat * V);
+    }
+  }
+}
+
+int OpenmcDriver::n_realizations() const
+{
+  int m = tally_->n_realizations_;
+
+  // Broadcast number of realizations
+  // TODO: Change OpenMC so that it's correct on all ranks
+  comm_.broadcast(m);
+  return m;
 }
 
 std::vector<CellHandle> OpenmcDriver::find(const std::vector<Position>& positions)
 {
+  // Locate the cell instance containing each position. Lookups are independent, so
+  // they are spread over threads.
+  gsl::index n = positions.size();
+  std::vector<int32_t> indices(n);
+  std::vector<int32_t> instances(n);
+  int n_errors = 0;
+#pragma omp parallel for reduction(+ : n_errors)
+  for (gsl::index i = 0; i < n; ++i) {
+    const auto& r = positions[i];
+    double xyz[3] = {r.x, r.y, r.z};
+    if (openmc_find_cell(xyz, &indices[i], &instances[i]) < 0) {
+      ++n_errors;
+    }
+  }
+  if (n_errors > 0) {
+    throw std::runtime_error{"Could not find cells for " + std::to_string(n_errors) +
+                             " positions"};
+  }
+
+  // Assign handles in order of positions so that they do not depend on threading
   std::vector<CellHandle> handles;
   handles.reserve(positions.size());
 
   std::unordered_map<CellInstance, CellHandle> cell_index;
 
-  for (const auto& r : positions) {
+  for (gsl::index i = 0; i < n; ++i) {
     // Determine cell instance corresponding to global element
-    CellInstance c{r};
+    CellInstance c{indices[i], instances[i]};
 
     // If this cell instance hasn't been saved yet, add it to cells_ and
     // keep track of what index it corresponds to
@@ -133,6 +219,18 @@ std::vector<CellHandle> OpenmcDriver::find(const std::vector<Position>& position
   return handles;
 }
 
+void OpenmcDriver::reorder_cells(const std::vector<CellHandle>& order)
+{
+  Expects(order.size() == cells_.size());
+
+  std::vector<CellInstance> cells;
+  cells.reserve(cells_.size());
+  for (auto h : order) {
+    cells.push_back(cells_[h]);
+  }
+  cells_ = std::move(cells);
+}
+
 void OpenmcDriver::set_density(CellHandle cell, double rho) const
 {
   cells_[cell].material()->set_density(rho, "g/cm3");
@@ -176,6 +274,23 @@ std::string OpenmcDriver::cell_label(CellHandle cell) const
   return label.str();
 }
 
+int64_t OpenmcDriver::seed() const
+{
+  return openmc_get_seed();
+}
+
+void OpenmcDriver::set_seed(int64_t seed)
+{
+  openmc_set_seed(seed);
+}
+
+void OpenmcDriver::disable_output()
+{
+  openmc::settings::output_summary = false;
+  openmc::settings::output_tallies = false;
+  openmc::settings::statepoint_batch.clear();
+}
+
 void OpenmcDriver::init_step()
 {
   err_chk(openmc_simulation_init());
@@ -198,6 +313,15 @@ void OpenmcDriver::finalize_step()
   err_chk(openmc_simulation_finalize());
 }
 
+std::size_t OpenmcDriver::memory_bytes() const
+{
+  std::size_t bytes = cells_.capacity() * sizeof(CellInstance);
+  if (tally_) {
+    bytes += tally_->results_.size() * sizeof(double);
+  }
+  return bytes;
+}
+
 OpenmcDriver::~OpenmcDriver()
 {
   if (active()) {
@@ -0,0 +1,49 @@
+#include "enrico/predictor.h"
+
+#include <gsl/gsl>
+
+#include <algorithm> // for min
+
+namespace enrico {
+
+int extrapolation_order(int max_order, const std::deque<double>& times)
+{
+  Expects(!times.empty());
+  return std::min<int>(max_order, times.size() - 1);
+}
+
+std::vector<double>
+extrapolation_weights(const std::deque<double>& times, int order, double t)
+{
+  Expects(order >= 0 && order < times.size());
+
+  // Lagrange basis polynomials of the previous times, evaluated at t
+  std::vector<double> weights(order + 1, 1.0);
+  for (int k = 0; k <= order; ++k) {
+    for (int j = 0; j <= order; ++j) {
+      if (j != k) {
+        Expects(times[k] != times[j]);
+        weights[k] *= (t - times[j]) / (times[k] - times[j]);
+      }
+    }
+  }
+  return weights;
+}
+
+void extrapolate(const std::deque<xt::xtensor<double, 1>>& history,
+                 const std::vector<double>& weights,
+                 xt::xtensor<double, 1>& field)
+{
+  Expects(!weights.empty() && weights.size() <= history.size());
+
+  const auto& last = history.front();
+  for (gsl::index i = 0; i < field.size(); ++i) {
+    double value = 0.0;
+    for (gsl::index k = 0; k < weights.size(); ++k) {
+      value += weights[k] * history[k](i);
+    }
+    field(i) = value > 0.0 ? value : last(i);
+  }
+}
+
+} // namespace enrico
@@ -8,6 +8,7 @@
 #include "Teuchos_XMLParameterListHelpers.hpp" // for RCP, ParameterList
 
 #include <unordered_map>
+#include <utility> // for move
 
 namespace enrico {
 
@@ -80,6 +81,22 @@ std::vector<CellHandle> ShiftDriver::find(const std::vector<Position>& positions
   return handles;
 }
 
+void ShiftDriver::reorder_cells(const std::vector<CellHandle>& order)
+{
+  Expects(order.size() == cells_.size());
+
+  std::vector<cell_type> cells;
+  cells.reserve(cells_.size());
+  for (auto h : order) {
+    cells.push_back(cells_[h]);
+  }
+  cells_ = std::move(cells);
+
+  for (CellHandle h = 0; h < cells_.size(); ++h) {
+    cell_index_[cells_[h]] = h;
+  }
+}
+
 void ShiftDriver::create_tallies()
 {
   auto tally_pl = Teuchos::sublist(plist_, "TALLY");
@@ -0,0 +1,116 @@
+#include "enrico/space_filling_curve.h"
+
+#include <gsl/gsl>
+
+#include <algorithm> // for max, min, sort
+#include <cmath>     // for floor
+#include <limits>    // for numeric_limits
+#include <utility>   // for pair
+
+namespace enrico {
+
+namespace {
+
+//! Spread the lowest CURVE_BITS bits of a value so that there are two zero bits
+//! between consecutive bits
+std::uint64_t spread_bits(std::uint32_t v)
+{
+  std::uint64_t x = v & 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8) & 0x100f00f00f00f00f;
+  x = (x | x << 4) & 0x10c30c30c30c30c3;
+  x = (x | x << 2) & 0x1249249249249249;
+  return x;
+}
+
+//! Map a coordinate into [0, 2^CURVE_BITS)
+std::uint32_t quantize(double x, double lower, double scale)
+{
+  constexpr double max_value = (1u << CURVE_BITS) - 1;
+  double q = std::floor((x - lower) * scale);
+  return static_cast<std::uint32_t>(std::min(std::max(q, 0.0), max_value));
+}
+
+} // namespace
+
+std::uint64_t morton_key(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+{
+  return spread_bits(x) << 2 | spread_bits(y) << 1 | spread_bits(z);
+}
+
+std::uint64_t hilbert_key(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+{
+  // Transform the coordinates in place so that interleaving their bits gives the
+  // distance along the curve (J. Skilling, AIP Conf. Proc. 707, 381 (2004))
+  std::uint32_t X[3] = {x, y, z};
+  const std::uint32_t M = 1u << (CURVE_BITS - 1);
+
+  // Undo the excess work of the rotations and reflections of each level
+  for (std::uint32_t Q = M; Q > 1; Q >>= 1) {
+    std::uint32_t P = Q - 1;
+    for (int i = 0; i < 3; ++i) {
+      if (X[i] & Q) {
+        X[0] ^= P;
+      } else {
+        std::uint32_t t = (X[0] ^ X[i]) & P;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encode
+  X[1] ^= X[0];
+  X[2] ^= X[1];
+  std::uint32_t t = 0;
+  for (std::uint32_t Q = M; Q > 1; Q >>= 1) {
+    if (X[2] & Q) {
+      t ^= Q - 1;
+    }
+  }
+  for (auto& v : X) {
+    v ^= t;
+  }
+
+  return morton_key(X[0], X[1], X[2]);
+}
+
+std::vector<int32_t> curve_order(const std::vector<Position>& points, CellOrder order)
+{
+  Expects(order != CellOrder::find);
+
+  // Determine the bounding box of the points
+  double inf = std::numeric_limits<double>::infinity();
+  Position lower{inf, inf, inf};
+  Position upper{-inf, -inf, -inf};
+  for (const auto& p : points) {
+    lower = {std::min(lower.x, p.x), std::min(lower.y, p.y), std::min(lower.z, p.z)};
+    upper = {std::max(upper.x, p.x), std::max(upper.y, p.y), std::max(upper.z, p.z)};
+  }
+
+  // Use the same scale in each direction so that the curve is not stretched
+  double width = std::max({upper.x - lower.x, upper.y - lower.y, upper.z - lower.z});
+  double scale = width > 0.0 ? (1u << CURVE_BITS) / width : 0.0;
+
+  std::vector<std::pair<std::uint64_t, int32_t>> keys(points.size());
+  int32_t n = keys.size();
+  for (int32_t i = 0; i < n; ++i) {
+    const auto& p = points[i];
+    auto x = quantize(p.x, lower.x, scale);
+    auto y = quantize(p.y, lower.y, scale);
+    auto z = quantize(p.z, lower.z, scale);
+    keys[i] = {order == CellOrder::morton ? morton_key(x, y, z) : hilbert_key(x, y, z),
+               i};
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<int32_t> indices;
+  indices.reserve(keys.size());
+  for (const auto& k : keys) {
+    indices.push_back(k.second);
+  }
+  return indices;
+}
+
+} // namespace enrico
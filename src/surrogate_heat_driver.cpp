@@ -10,7 +10,7 @@
 #include "xtensor/xnorm.hpp"
 #include "xtensor/xview.hpp"
 
-#include <algorithm> // for fill_n
+#include <algorithm> // for copy, fill_n, min, upper_bound
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include <iostream>
@@ -208,7 +208,11 @@ void SurrogateHeatDriver::generate_arrays()
   if (this->has_coupling_data()) {
     // Create empty arrays for source term and temperature in the solid phase
     source_ = xt::empty<double>({n_pins_, n_axial_, n_rings(), n_azimuthal_});
+
+    // The solid starts at the inlet temperature, which is the initial condition
+    // of a transient
     solid_temperature_ = xt::empty<double>({n_pins_, n_axial_, n_rings()});
+    solid_temperature_.fill(inlet_temperature_);
 
     // Create empty arrays for temperature and density in the fluid phase
     fluid_temperature_ = xt::empty<double>({n_pins_, n_axial_});
@@ -291,44 +295,59 @@ std::vector<Position> SurrogateHeatDriver::centroid_local() const
   return centroids;
 }
 
-std::vector<double> SurrogateHeatDriver::temperature_local() const
+void SurrogateHeatDriver::temperature_local(gsl::span<double> local) const
 {
-  std::vector<double> local_temperatures;
+  Expects(local.size() == this->n_local_elem());
 
   if (this->has_coupling_data()) {
+    auto out = local.begin();
     for (gsl::index i = 0; i < n_pins_; ++i) {
       for (gsl::index j = 0; j < n_axial_; ++j) {
         for (gsl::index k = 0; k < n_rings(); ++k) {
-          for (gsl::index m = 0; m < n_azimuthal_; ++m) {
-            local_temperatures.push_back(solid_temperature_(i, j, k));
-          }
+          out = std::fill_n(out, n_azimuthal_, solid_temperature_(i, j, k));
         }
       }
     }
 
-    for (double T : fluid_temperature_) {
-      local_temperatures.push_back(T);
-    }
+    std::copy(fluid_temperature_.begin(), fluid_temperature_.end(), out);
   }
-
-  return local_temperatures;
 }
 
-std::vector<double> SurrogateHeatDriver::density_local() const
+void SurrogateHeatDriver::density_local(gsl::span<double> local) const
 {
-  std::vector<double> local_densities;
+  Expects(local.size() == this->n_local_elem());
 
   if (this->has_coupling_data()) {
     // Solid region just gets zeros for densities (not used)
     auto n = n_pins_ * n_axial_ * n_rings() * n_azimuthal_;
-    std::fill_n(std::back_inserter(local_densities), n, 0.0);
+    auto out = std::fill_n(local.begin(), n, 0.0);
+
+    // Add fluid densities
+    std::copy(fluid_density_.begin(), fluid_density_.end(), out);
+  }
+}
+
+void SurrogateHeatDriver::fields_local(gsl::span<ElementFields> local) const
+{
+  Expects(local.size() == this->n_local_elem());
+
+  if (this->has_coupling_data()) {
+    // Solid region just gets zeros for densities (not used)
+    gsl::index elem = 0;
+    for (gsl::index i = 0; i < n_pins_; ++i) {
+      for (gsl::index j = 0; j < n_axial_; ++j) {
+        for (gsl::index k = 0; k < n_rings(); ++k) {
+          for (gsl::index m = 0; m < n_azimuthal_; ++m) {
+            local[elem++] = {solid_temperature_(i, j, k), 0.0};
+          }
+        }
+      }
+    }
 
-    // Add fluid densities and return
-    for (double rho : fluid_density_) {
-      local_densities.push_back(rho);
+    for (gsl::index i = 0; i < fluid_temperature_.size(); ++i) {
+      local[elem++] = {fluid_temperature_.data()[i], fluid_density_.data()[i]};
     }
   }
-  return local_densities;
 }
 
 std::vector<int> SurrogateHeatDriver::fluid_mask_local() const
@@ -375,6 +394,53 @@ std::vector<double> SurrogateHeatDriver::volume_local() const
   return volumes;
 }
 
+int32_t SurrogateHeatDriver::element_at(const Position& r) const
+{
+  // Determine axial segment
+  if (r.z < z_(0) || r.z >= z_(n_axial_))
+    return -1;
+  auto axial = std::upper_bound(z_.begin(), z_.end(), r.z) - z_.begin() - 1;
+
+  // Determine the pin whose (pitch x pitch) square contains the position. The
+  // assembly is centered at x = 0, y = 0.
+  double col_f = std::floor((r.x + 0.5 * n_pins_x_ * pin_pitch_) / pin_pitch_);
+  double row_f = std::floor((0.5 * n_pins_y_ * pin_pitch_ - r.y) / pin_pitch_);
+  if (col_f < 0 || col_f >= n_pins_x_ || row_f < 0 || row_f >= n_pins_y_)
+    return -1;
+  gsl::index pin =
+    static_cast<gsl::index>(row_f) * n_pins_x_ + static_cast<gsl::index>(col_f);
+
+  // Fluid elements follow all solid elements
+  double dx = r.x - pin_centers_(pin, 0);
+  double dy = r.y - pin_centers_(pin, 1);
+  double radius = std::sqrt(dx * dx + dy * dy);
+  if (radius >= clad_outer_radius_) {
+    auto n_solid = n_pins_ * n_axial_ * n_rings() * n_azimuthal_;
+    return n_solid + pin * n_axial_ + axial;
+  }
+
+  // Determine ring, with rings equally spaced in the fuel and in the clad
+  gsl::index ring;
+  if (radius < pellet_radius_) {
+    ring = static_cast<gsl::index>(radius / pellet_radius_ * n_fuel_rings_);
+  } else if (radius >= clad_inner_radius_) {
+    double frac =
+      (radius - clad_inner_radius_) / (clad_outer_radius_ - clad_inner_radius_);
+    ring = n_fuel_rings_ + static_cast<gsl::index>(frac * n_clad_rings_);
+  } else {
+    return -1;
+  }
+
+  // Determine azimuthal segment, with angles measured counterclockwise from +x
+  double theta = std::atan2(dy, dx);
+  if (theta < 0.0)
+    theta += 2.0 * M_PI;
+  auto azimuthal = std::min<gsl::index>(
+    static_cast<gsl::index>(theta / (2.0 * M_PI) * n_azimuthal_), n_azimuthal_ - 1);
+
+  return ((pin * n_axial_ + axial) * n_rings() + ring) * n_azimuthal_ + azimuthal;
+}
+
 int SurrogateHeatDriver::set_heat_source_at(int32_t local_elem, double heat)
 {
   if (local_elem >= n_pins_ * n_axial_ * n_rings() * n_azimuthal_)
@@ -415,6 +481,24 @@ void SurrogateHeatDriver::solve_step()
   }
 }
 
+void SurrogateHeatDriver::set_timestep(double time, double dt)
+{
+  Expects(dt >= 0.0);
+  dt_ = dt;
+}
+
+void SurrogateHeatDriver::save_state()
+{
+  if (has_coupling_data())
+    saved_solid_temperature_ = solid_temperature_;
+}
+
+void SurrogateHeatDriver::restore_state()
+{
+  if (has_coupling_data())
+    solid_temperature_ = saved_solid_temperature_;
+}
+
 void SurrogateHeatDriver::solve_fluid()
 {
   // determine the power deposition in each channel; the target applications will
@@ -612,6 +696,23 @@ void SurrogateHeatDriver::solve_heat()
   xt::xtensor<double, 1> r_fuel = 0.01 * r_grid_fuel_;
   xt::xtensor<double, 1> r_clad = 0.01 * r_grid_clad_;
 
+  // In transient mode, all pin segments advance from the current solid temperature
+  // in a single batched solve
+  if (dt_ > 0.0) {
+    // approximate cladding surface temperature as equal to the fluid temperature
+    solve_transient(q.data(),
+                    fluid_temperature_.data(),
+                    r_fuel.data(),
+                    r_clad.data(),
+                    n_fuel_rings_,
+                    n_clad_rings_,
+                    n_pins_ * n_axial_,
+                    dt_,
+                    heat_tol_,
+                    solid_temperature_.data());
+    return;
+  }
+
   for (gsl::index i = 0; i < n_pins_; ++i) {
     for (gsl::index j = 0; j < n_axial_; ++j) {
       // approximate cladding surface temperature as equal to the fluid
@@ -0,0 +1,195 @@
+#include "enrico/trace.h"
+
+#include <algorithm> // for min
+#include <chrono>
+#include <cstdio> // for snprintf
+#include <limits> // for numeric_limits
+#include <memory> // for unique_ptr
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace enrico {
+
+namespace detail {
+std::atomic<bool> trace_enabled{false};
+} // namespace detail
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+//! A complete event, which is written with the "X" phase of the Chrome trace format
+struct TraceEvent {
+  const char* name; //!< Name of the event
+  double start;     //!< Start time in [us]
+  double duration;  //!< Duration in [us]
+  long bytes;       //!< Bytes communicated, or -1
+};
+
+//! Ring buffer of the events recorded by one thread
+struct TraceBuffer {
+  std::vector<TraceEvent> events; //!< Storage, allocated when the buffer is created
+  std::size_t n_recorded{0};      //!< Number of events recorded, including overwritten
+  int thread;                     //!< Index of the thread in order of first event
+};
+
+//! Time at which tracing started
+Clock::time_point trace_start;
+
+//! Number of events held by each buffer
+std::size_t trace_capacity{0};
+
+//! Buffers of all threads that have recorded events. The mutex guards the creation of
+//! buffers; each buffer is only written by its own thread.
+std::vector<std::unique_ptr<TraceBuffer>> trace_buffers;
+std::mutex trace_mutex;
+
+//! Get the buffer of the calling thread, creating it on the thread's first event
+TraceBuffer& thread_buffer()
+{
+  thread_local TraceBuffer* buffer = nullptr;
+  if (!buffer) {
+    std::lock_guard<std::mutex> lock{trace_mutex};
+    trace_buffers.emplace_back(new TraceBuffer);
+    buffer = trace_buffers.back().get();
+    buffer->events.resize(trace_capacity);
+    buffer->thread = trace_buffers.size() - 1;
+  }
+  return *buffer;
+}
+
+//! Append the JSON records of this rank's events to a string
+void append_events(std::string& out, int rank)
+{
+  char line[256];
+  for (const auto& buffer : trace_buffers) {
+    auto n = std::min(buffer->n_recorded, buffer->events.size());
+    // Once the buffer has wrapped around, the oldest event is at the next write
+    // position
+    auto first = buffer->n_recorded - n;
+    for (std::size_t i = first; i < buffer->n_recorded; ++i) {
+      const auto& e = buffer->events[i % buffer->events.size()];
+      int len;
+      if (e.bytes >= 0) {
+        len = std::snprintf(line,
+                            sizeof(line),
+                            ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"bytes\":%ld}}",
+                            e.name,
+                            rank,
+                            buffer->thread,
+                            e.start,
+                            e.duration,
+                            e.bytes);
+      } else {
+        len = std::snprintf(line,
+                            sizeof(line),
+                            ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                            "\"ts\":%.3f,\"dur\":%.3f}",
+                            e.name,
+                            rank,
+                            buffer->thread,
+                            e.start,
+                            e.duration);
+      }
+      out.append(line, std::min<std::size_t>(len, sizeof(line) - 1));
+    }
+  }
+}
+
+} // namespace
+
+void start_tracing(std::size_t capacity)
+{
+  if (capacity == 0) {
+    throw std::runtime_error{"Trace buffers must hold at least one event"};
+  }
+  trace_capacity = capacity;
+  trace_start = Clock::now();
+  detail::trace_enabled.store(true);
+}
+
+double trace_time()
+{
+  return std::chrono::duration<double, std::micro>(Clock::now() - trace_start).count();
+}
+
+void trace_event(const char* name, double start, long bytes)
+{
+  double end = trace_time();
+  auto& buffer = thread_buffer();
+  auto i = buffer.n_recorded % buffer.events.size();
+  buffer.events[i] = {name, start, end - start, bytes};
+  ++buffer.n_recorded;
+}
+
+void write_trace(MPI_Comm comm, const std::string& filename)
+{
+  int started = trace_capacity > 0;
+  MPI_Allreduce(MPI_IN_PLACE, &started, 1, MPI_INT, MPI_MAX, comm);
+  if (!started) {
+    return;
+  }
+  detail::trace_enabled.store(false);
+
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  // Rank 0 writes the header and the last rank the footer of the JSON file
+  std::string events;
+  if (rank == 0) {
+    events = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  }
+
+  // Name each rank's process so that Perfetto labels it. Each record starts with a
+  // separating comma, so the comma of the first record in the file is skipped.
+  char line[128];
+  int len = std::snprintf(line,
+                          sizeof(line),
+                          ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                          "\"args\":{\"name\":\"rank %d\"}}",
+                          rank,
+                          rank);
+  int skip = rank == 0 ? 1 : 0;
+  events.append(line + skip, len - skip);
+  append_events(events, rank);
+  if (rank == size - 1) {
+    events += "\n]}\n";
+  }
+
+  // Each rank writes its events directly at its offset in the file, so that no rank
+  // has to hold the events of all ranks
+  MPI_Offset n = events.size();
+  MPI_Offset offset = 0;
+  MPI_Exscan(&n, &offset, 1, MPI_OFFSET, MPI_SUM, comm);
+  if (rank == 0) {
+    offset = 0;
+  }
+
+  MPI_File fh;
+  int err = MPI_File_open(comm,
+                          filename.c_str(),
+                          MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                          MPI_INFO_NULL,
+                          &fh);
+  if (err != MPI_SUCCESS) {
+    throw std::runtime_error{"Unable to open trace file " + filename};
+  }
+  MPI_File_set_size(fh, 0);
+
+  // Counts are ints, so large buffers are written in several pieces
+  constexpr MPI_Offset max_count = std::numeric_limits<int>::max();
+  for (MPI_Offset pos = 0; pos < n && err == MPI_SUCCESS; pos += max_count) {
+    int count = std::min(max_count, n - pos);
+    err = MPI_File_write_at(
+      fh, offset + pos, &events[pos], count, MPI_CHAR, MPI_STATUS_IGNORE);
+  }
+  MPI_File_close(&fh);
+  if (err != MPI_SUCCESS) {
+    throw std::runtime_error{"Unable to write trace file " + filename};
+  }
+}
+
+} // namespace enrico
@@ -0,0 +1,82 @@
+/**
+ * \file test_bit_mask.cpp
+ * \brief Unit tests for the bit-packed boolean masks.
+ */
+
+#include "catch.hpp"
+#include "enrico/bit_mask.h"
+
+#include <cstdint>
+#include <vector>
+
+using enrico::BitMask;
+
+TEST_CASE("Verify bit masks around word boundaries", "[bit_mask]") {
+  for (std::size_t size : {63, 64, 65}) {
+    BitMask mask(size);
+    CHECK(mask.size() == size);
+    CHECK(mask.words().size() == (size + 63) / 64);
+    CHECK(mask.count() == 0);
+
+    // Set the first and last bits of each word and the last bit of the mask
+    std::vector<std::size_t> bits{0, 62, size - 1};
+    if (size > 64) {
+      bits.push_back(63);
+      bits.push_back(64);
+    }
+    for (auto i : bits) {
+      mask.set(i);
+    }
+    std::size_t n_set = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+      bool expected = false;
+      for (auto j : bits) {
+        expected = expected || i == j;
+      }
+      CHECK(mask[i] == expected);
+      n_set += expected;
+    }
+    CHECK(mask.count() == n_set);
+
+    // Clearing the last bit leaves the others set
+    mask.reset(size - 1);
+    CHECK_FALSE(mask[size - 1]);
+    CHECK(mask[0]);
+    CHECK(mask.count() == n_set - 1);
+  }
+}
+
+TEST_CASE("Verify the layout of bit mask words", "[bit_mask]") {
+  BitMask mask(65);
+  mask.set(0);
+  mask.set(63);
+  mask.set(64);
+  CHECK(mask.words()[0] == ((std::uint64_t{1} << 63) | 1));
+  CHECK(mask.words()[1] == 1);
+
+  // Words copied from another mask of equal size carry its bits
+  BitMask copy(65);
+  copy.words() = mask.words();
+  CHECK(copy[0]);
+  CHECK(copy[63]);
+  CHECK(copy[64]);
+  CHECK(copy.count() == 3);
+}
+
+TEST_CASE("Verify construction of bit masks from flags", "[bit_mask]") {
+  std::vector<int> flags(65, 0);
+  flags[1] = 1;
+  flags[63] = -1;
+  flags[64] = 7;
+  BitMask mask{flags};
+  CHECK(mask.size() == 65);
+  for (std::size_t i = 0; i < flags.size(); ++i) {
+    CHECK(mask[i] == (flags[i] != 0));
+  }
+  CHECK(mask.count() == 3);
+
+  BitMask empty{std::vector<int>{}};
+  CHECK(empty.size() == 0);
+  CHECK(empty.words().empty());
+  CHECK(empty.count() == 0);
+}
@@ -0,0 +1,97 @@
+/**
+ * \file test_compact_field.cpp
+ * \brief Unit tests for the reduced-precision transfer of coupled fields.
+ */
+
+#include "catch.hpp"
+#include "enrico/compact_field.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using enrico::CompactField;
+using enrico::Precision;
+
+namespace {
+
+//! Encode and decode a field
+std::vector<double> round_trip(CompactField& compact, const std::vector<double>& values)
+{
+  compact.encode(gsl::span<const double>(values));
+  std::vector<double> decoded(compact.size());
+  compact.decode(gsl::span<double>(decoded));
+  return decoded;
+}
+
+} // namespace
+
+TEST_CASE("Verify round trip of compact fields", "[compact_field]") {
+  // Interleaved temperatures and densities
+  std::vector<double> values{
+    565.0, 0.74, 600.125, 0.7125, 923.4567, 0.70001, 1200.0, 0.7312};
+
+  SECTION("Verify single precision round trip") {
+    CompactField compact{Precision::single, 2};
+    auto decoded = round_trip(compact, values);
+    REQUIRE(decoded.size() == values.size());
+
+    double error[2] = {0.0, 0.0};
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      double diff = std::abs(decoded[i] - values[i]);
+      CHECK(diff <= 6.0e-8 * std::abs(values[i]));
+      error[i % 2] = std::max(error[i % 2], diff);
+    }
+    CHECK(compact.max_error(0) == error[0]);
+    CHECK(compact.max_error(1) == error[1]);
+
+    // Values representable in single precision are exact
+    CHECK(decoded[0] == 565.0);
+    CHECK(decoded[2] == 600.125);
+  }
+
+  SECTION("Verify fixed-point round trip") {
+    CompactField compact{Precision::fixed16, 2};
+    auto decoded = round_trip(compact, values);
+    REQUIRE(decoded.size() == values.size());
+
+    double error[2] = {0.0, 0.0};
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      error[i % 2] = std::max(error[i % 2], std::abs(decoded[i] - values[i]));
+    }
+    CHECK(compact.max_error(0) == Approx(error[0]).margin(1.0e-12));
+    CHECK(compact.max_error(1) == Approx(error[1]).margin(1.0e-12));
+
+    // Each component is scaled to its own range, so the error is at most half a step
+    double step_T = (1200.0 - 565.0) / 65535.0;
+    double step_rho = (0.74 - 0.70001) / 65535.0;
+    CHECK(compact.max_error(0) <= 0.5 * step_T * (1.0 + 1.0e-9));
+    CHECK(compact.max_error(1) <= 0.5 * step_rho * (1.0 + 1.0e-9));
+
+    // The ends of each range are exact
+    CHECK(decoded[0] == Approx(565.0).margin(1.0e-9));
+    CHECK(decoded[6] == Approx(1200.0).margin(1.0e-9));
+    CHECK(decoded[5] == Approx(0.70001).margin(1.0e-12));
+    CHECK(decoded[1] == Approx(0.74).margin(1.0e-12));
+  }
+
+  SECTION("Verify that a constant component is exact in fixed point") {
+    std::vector<double> constant{300.0, 1.0, 300.0, 2.0, 300.0, 3.0};
+    CompactField compact{Precision::fixed16, 2};
+    auto decoded = round_trip(compact, constant);
+    for (std::size_t i = 0; i < constant.size(); i += 2) {
+      CHECK(decoded[i] == 300.0);
+    }
+    CHECK(compact.max_error(0) == 0.0);
+  }
+
+  SECTION("Verify that the error is reset by each encode") {
+    CompactField compact{Precision::fixed16, 2};
+    round_trip(compact, values);
+    REQUIRE(compact.max_error(0) > 0.0);
+    round_trip(compact, {300.0, 1.0, 300.0, 1.0});
+    CHECK(compact.max_error(0) == 0.0);
+    CHECK(compact.max_error(1) == 0.0);
+    CHECK(compact.size() == 4);
+  }
+}
@@ -0,0 +1,108 @@
+/**
+ * \file test_predictor.cpp
+ * \brief Unit tests for the extrapolation of coupled fields between timesteps.
+ */
+
+#include "catch.hpp"
+#include "enrico/predictor.h"
+
+#include <deque>
+
+namespace {
+
+//! Make a field with two entries
+xt::xtensor<double, 1> field_of(double a, double b)
+{
+  xt::xtensor<double, 1> field({2}, 0.0);
+  field(0) = a;
+  field(1) = b;
+  return field;
+}
+
+} // namespace
+
+TEST_CASE("Verify extrapolation of fields between timesteps", "[predictor]") {
+  xt::xtensor<double, 1> field({2}, 0.0);
+
+  SECTION("Verify that order 0 keeps the most recent field") {
+    std::deque<xt::xtensor<double, 1>> history{field_of(5.0, 7.0)};
+    auto weights = enrico::extrapolation_weights({1.0}, 0, 2.0);
+    enrico::extrapolate(history, weights, field);
+    CHECK(field(0) == Approx(5.0));
+    CHECK(field(1) == Approx(7.0));
+  }
+
+  SECTION("Verify that the order is limited by the saved timesteps") {
+    // Save the end time of each timestep as the coupled driver does, keeping at most
+    // order + 1 of them, and select the order at the start of the next timestep
+    int max_order = 2;
+    std::deque<double> times{1.0};
+    CHECK(enrico::extrapolation_order(max_order, times) == 0);
+    CHECK(enrico::extrapolation_weights(times, 0, 2.0).size() == 1);
+
+    times.push_front(2.0);
+    CHECK(enrico::extrapolation_order(max_order, times) == 1);
+    CHECK(enrico::extrapolation_weights(times, 1, 3.0).size() == 2);
+
+    times.push_front(3.0);
+    times.push_front(4.0);
+    times.pop_back();
+    CHECK(enrico::extrapolation_order(max_order, times) == 2);
+    CHECK(enrico::extrapolation_order(1, times) == 1);
+  }
+
+  SECTION("Verify the weights for equally spaced timesteps") {
+    auto linear = enrico::extrapolation_weights({2.0, 1.0}, 1, 3.0);
+    CHECK(linear[0] == Approx(2.0));
+    CHECK(linear[1] == Approx(-1.0));
+    auto quadratic = enrico::extrapolation_weights({3.0, 2.0, 1.0}, 2, 4.0);
+    CHECK(quadratic[0] == Approx(3.0));
+    CHECK(quadratic[1] == Approx(-3.0));
+    CHECK(quadratic[2] == Approx(1.0));
+  }
+
+  SECTION("Verify that linear extrapolation is exact for linear fields") {
+    // f(t) = 10 + 2t at t = 2, 1, extrapolated to t = 3
+    std::deque<xt::xtensor<double, 1>> history{field_of(14.0, 4.0),
+                                               field_of(12.0, 5.0)};
+    auto weights = enrico::extrapolation_weights({2.0, 1.0}, 1, 3.0);
+    enrico::extrapolate(history, weights, field);
+    CHECK(field(0) == Approx(16.0));
+    CHECK(field(1) == Approx(3.0));
+  }
+
+  SECTION("Verify that quadratic extrapolation is exact for quadratic fields") {
+    // f(t) = 1 + t + t^2 at t = 3, 2, 1, extrapolated to t = 4
+    std::deque<xt::xtensor<double, 1>> history{
+      field_of(13.0, 13.0), field_of(7.0, 7.0), field_of(3.0, 3.0)};
+    auto weights = enrico::extrapolation_weights({3.0, 2.0, 1.0}, 2, 4.0);
+    enrico::extrapolate(history, weights, field);
+    CHECK(field(0) == Approx(21.0));
+    CHECK(field(1) == Approx(21.0));
+  }
+
+  SECTION("Verify that extrapolation is exact for unequal timesteps") {
+    // f(t) = 1 + t + t^2 at t = 1.5, 1, 0.25, extrapolated to t = 2.25
+    std::deque<xt::xtensor<double, 1>> history{
+      field_of(4.75, 4.75), field_of(3.0, 3.0), field_of(1.3125, 1.3125)};
+    auto weights = enrico::extrapolation_weights({1.5, 1.0, 0.25}, 2, 2.25);
+    enrico::extrapolate(history, weights, field);
+    CHECK(field(0) == Approx(8.3125));
+
+    // Only the most recent values are used for a lower order
+    weights = enrico::extrapolation_weights({1.5, 1.0, 0.25}, 1, 2.25);
+    REQUIRE(weights.size() == 2);
+    enrico::extrapolate(history, weights, field);
+    CHECK(field(0) == Approx(7.375));
+  }
+
+  SECTION("Verify that non-positive values fall back to the most recent field") {
+    // The second entry drops to 0.5 from 2.0, so it extrapolates to -1.0
+    std::deque<xt::xtensor<double, 1>> history{field_of(3.0, 0.5),
+                                               field_of(2.0, 2.0)};
+    auto weights = enrico::extrapolation_weights({2.0, 1.0}, 1, 3.0);
+    enrico::extrapolate(history, weights, field);
+    CHECK(field(0) == Approx(4.0));
+    CHECK(field(1) == Approx(0.5));
+  }
+}
@@ -0,0 +1,65 @@
+/**
+ * \file test_space_filling_curve.cpp
+ * \brief Unit tests for the keys of the space-filling curves used to order cells.
+ */
+
+#include "catch.hpp"
+#include "enrico/space_filling_curve.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+using enrico::hilbert_key;
+using enrico::morton_key;
+
+TEST_CASE("Verify interleaving of Morton keys", "[space_filling_curve]") {
+  // The x bit is the highest of each triple, followed by the y and z bits
+  CHECK(morton_key(0, 0, 0) == 0);
+  CHECK(morton_key(1, 0, 0) == 4);
+  CHECK(morton_key(0, 1, 0) == 2);
+  CHECK(morton_key(0, 0, 1) == 1);
+  CHECK(morton_key(3, 0, 0) == 0b100100);
+  CHECK(morton_key(0, 3, 0) == 0b010010);
+  CHECK(morton_key(5, 6, 3) == 0b110011101);
+
+  // The highest bit of each coordinate ends up in the highest triple of the key
+  constexpr std::uint32_t top = 1u << (enrico::CURVE_BITS - 1);
+  CHECK(morton_key(top, 0, 0) == std::uint64_t{1} << (3 * enrico::CURVE_BITS - 1));
+  CHECK(morton_key(0, 0, top) == std::uint64_t{1} << (3 * enrico::CURVE_BITS - 3));
+}
+
+TEST_CASE("Verify adjacency of consecutive Hilbert keys", "[space_filling_curve]") {
+  // Key every point of an 8 x 8 x 8 grid at the corner of the curve's domain
+  constexpr std::uint32_t n = 8;
+  std::vector<std::pair<std::uint64_t, std::array<int, 3>>> keyed;
+  for (std::uint32_t x = 0; x < n; ++x) {
+    for (std::uint32_t y = 0; y < n; ++y) {
+      for (std::uint32_t z = 0; z < n; ++z) {
+        std::array<int, 3> point{static_cast<int>(x),
+                                 static_cast<int>(y),
+                                 static_cast<int>(z)};
+        keyed.emplace_back(hilbert_key(x, y, z), point);
+      }
+    }
+  }
+  std::sort(keyed.begin(), keyed.end());
+
+  // The curve fills the corner of its domain before leaving it, so the keys of the
+  // grid are exactly the first n^3 keys
+  for (std::size_t i = 0; i < keyed.size(); ++i) {
+    CHECK(keyed[i].first == i);
+  }
+
+  // Consecutive points along the curve are neighbours on the grid
+  for (std::size_t i = 1; i < keyed.size(); ++i) {
+    const auto& a = keyed[i - 1].second;
+    const auto& b = keyed[i].second;
+    int distance =
+      std::abs(a[0] - b[0]) + std::abs(a[1] - b[1]) + std::abs(a[2] - b[2]);
+    CHECK(distance == 1);
+  }
+}
@@ -6,6 +6,9 @@
 #include "catch.hpp"
 #include "pugixml.hpp"
 #include "enrico/surrogate_heat_driver.h"
+#include "surrogates/heat_xfer_backend.h"
+
+#include <vector>
 
 TEST_CASE("Verify construction of surrogate thermal-hydraulics driver", "[construction]") {
   // load input file
@@ -436,4 +439,84 @@ TEST_CASE("Verify construction of surrogate thermal-hydraulics driver", "[constr
     CHECK(rc(3) == Approx(0.475));
   }
 
+  SECTION("Verify point location of elements") {
+    using enrico::Position;
+
+    // fuel ring 1, axial segment 0, azimuthal segment 0 of pin 0
+    CHECK(driver.element_at(Position{-3.68, 1.9, 0.3}) == 4);
+
+    // clad ring 1, axial segment 2, azimuthal segment 3 of pin 8
+    CHECK(driver.element_at(Position{-2.52, 0.19, 1.2}) == 1627);
+
+    // fluid around pin 0 in axial segment 5, following all 5376 solid elements
+    CHECK(driver.element_at(Position{-3.28, 2.39, 2.15}) == 5381);
+
+    // pellet-clad gap and positions outside of the bundle
+    CHECK(driver.element_at(Position{-3.37, 1.89, 0.3}) == -1);
+    CHECK(driver.element_at(Position{-3.68, 1.9, 0.05}) == -1);
+    CHECK(driver.element_at(Position{5.0, 0.0, 0.3}) == -1);
+  }
+
+}
+
+TEST_CASE("Verify transient conduction in surrogate fuel pins", "[transient]") {
+  // radial grids in [m] for 5 fuel rings and 3 clad rings
+  int n_fuel = 5;
+  int n_clad = 3;
+  int n = n_fuel + n_clad;
+  std::vector<double> r_fuel(n_fuel + 1);
+  std::vector<double> r_clad(n_clad + 1);
+  for (int i = 0; i <= n_fuel; ++i)
+    r_fuel[i] = 0.00406 * i / n_fuel;
+  for (int i = 0; i <= n_clad; ++i)
+    r_clad[i] = 0.00414 + 0.00061 * i / n_clad;
+
+  // uniform heat source in [W/m^3] in the fuel only
+  std::vector<double> q(n, 0.0);
+  for (int i = 0; i < n_fuel; ++i)
+    q[i] = 3.0e8;
+
+  double T_co = 600.0;
+
+  SECTION("Verify that a long timestep reaches the steady state") {
+    std::vector<double> T_steady(n, T_co);
+    solve_steady_nonlin(q.data(), T_co, r_fuel.data(), r_clad.data(), n_fuel, n_clad,
+                        1.0e-8, T_steady.data());
+
+    // two identical segments solved in one batch
+    std::vector<double> source(q);
+    source.insert(source.end(), q.begin(), q.end());
+    std::vector<double> T(2 * n, T_co);
+    std::vector<double> T_b(2, T_co);
+    solve_transient(source.data(), T_b.data(), r_fuel.data(), r_clad.data(), n_fuel,
+                    n_clad, 2, 1.0e7, 1.0e-8, T.data());
+
+    for (int i = 0; i < n; ++i) {
+      CHECK(T[i] == Approx(T_steady[i]).epsilon(1.0e-5));
+      CHECK(T[n + i] == Approx(T_steady[i]).epsilon(1.0e-5));
+    }
+  }
+
+  SECTION("Verify that a short timestep follows the heat capacity") {
+    // over 0.1 ms, conduction is negligible at the pin center, so the temperature
+    // rises by q * dt / (rho * cp) with the heat capacity of UO2 at 1000 K
+    std::vector<double> T(n, 1000.0);
+    std::vector<double> T_b(1, 1000.0);
+    solve_transient(q.data(), T_b.data(), r_fuel.data(), r_clad.data(), n_fuel, n_clad,
+                    1, 1.0e-4, 1.0e-10, T.data());
+
+    CHECK(T[0] - 1000.0 == Approx(3.0e8 * 1.0e-4 / (10.97e3 * 311.388)).epsilon(1.0e-3));
+    CHECK(T[n - 1] == Approx(1000.0).epsilon(1.0e-6));
+  }
+
+  SECTION("Verify that a pin without a source stays at the coolant temperature") {
+    std::vector<double> zero(n, 0.0);
+    std::vector<double> T(n, T_co);
+    std::vector<double> T_b(1, T_co);
+    solve_transient(zero.data(), T_b.data(), r_fuel.data(), r_clad.data(), n_fuel,
+                    n_clad, 1, 0.1, 1.0e-8, T.data());
+
+    for (int i = 0; i < n; ++i)
+      CHECK(T[i] == Approx(T_co));
+  }
 }